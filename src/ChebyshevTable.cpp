@@ -0,0 +1,62 @@
+#include <cassert>
+#include <cmath>
+
+#include <boost/math/constants/constants.hpp>
+
+#include "ChebyshevTable.h"
+
+ChebyshevTable::ChebyshevTable( const PoleTable &table, double lower,
+                                double upper, int ndegree )
+    : size( table.dimension() ), degree( ndegree ),
+      center( 0.5 * ( lower + upper ) ), half_width( 0.5 * ( upper - lower ) ) {
+    assert( degree >= 0 );
+    assert( half_width > 0 );
+    const double pi = boost::math::constants::pi< double >();
+    int points = degree + 1;
+
+    // The table at the Chebyshev points x_j = cos( pi ( j + 1/2 ) / points )
+    std::vector< double >         E( points );
+    std::vector< util::matrix_t > values( points,
+                                          util::matrix_t( size, size ) );
+    for ( int j = 0; j < points; ++j ) {
+        E[j] = center + half_width * std::cos( pi * ( j + 0.5 ) / points );
+        values[j].clear(); }
+    table.evaluate( E, values );
+
+    // T_n( x_j )
+    std::vector< double > T( points * points );
+    for ( int n = 0; n < points; ++n ) {
+        for ( int j = 0; j < points; ++j ) {
+            T[ n * points + j ] = std::cos( pi * n * ( j + 0.5 ) / points ); } }
+
+    coefficients.reserve( size * ( size + 1 ) / 2 * points );
+    derivative_coefficients.reserve( size * ( size + 1 ) / 2 * degree );
+    std::vector< double > c( points ), dc( points + 1 );
+    for ( int i = 0; i < size; ++i ) {
+        for ( int k = i; k < size; ++k ) {
+            for ( int n = 0; n < points; ++n ) {
+                double s = 0;
+                for ( int j = 0; j < points; ++j ) {
+                    s += values[j]( i, k ) * T[ n * points + j ]; }
+                c[n] = 2 * s / points; }
+            c[0] *= 0.5;
+            coefficients.insert( coefficients.end(), c.begin(), c.end() );
+
+            // d/dx sum c_n T_n = sum dc_n T_n, from the top down
+            dc.assign( points + 1, 0 );
+            for ( int n = degree; n >= 1; --n ) {
+                dc[ n - 1 ] = dc[ n + 1 ] + 2 * n * c[n]; }
+            dc[0] *= 0.5;
+            derivative_coefficients.insert(
+                    derivative_coefficients.end(),
+                    dc.begin(), dc.begin() + degree ); } }
+}
+
+// Clenshaw's recurrence
+double ChebyshevTable::sum( const double *c, int terms, double x ) {
+    double b1 = 0, b2 = 0;
+    for ( int n = terms - 1; n >= 1; --n ) {
+        double b = 2 * x * b1 - b2 + c[n];
+        b2 = b1;
+        b1 = b; }
+    return terms > 0 ? x * b1 - b2 + c[0] : 0; }
@@ -0,0 +1,76 @@
+#ifndef _CHEBYSHEV_TABLE_H_
+#define _CHEBYSHEV_TABLE_H_
+/* Chebyshev interpolant of a PoleTable on an energy interval.
+ *
+ * Away from its poles every element of a PoleTable is smooth, and a short
+ * Chebyshev series represents it to near rounding error.  The table is
+ * sampled at degree + 1 Chebyshev points of [ lower, upper ]; evaluating
+ * the fit then costs degree + 1 terms per element, however many poles the
+ * element has.  The error falls off like rho^-degree, where
+ *      rho = x + sqrt( x^2 - 1 ),  x = 1 + 2 d / ( upper - lower )
+ * for the closest pole, a distance d outside the interval.  The fit is only
+ * meant to be used inside the interval.
+ *
+ * Example:
+ *  ChebyshevTable fit( far_poles, 1.5, 2.5, 24 );
+ *  fit.evaluate( 2.0, m );             // m += far_poles( 2.0 ), nearly
+ *  fit.evaluate_derivative( 2.0, m );
+ */
+
+#include <vector>
+
+#include "PoleTable.h"
+
+class ChebyshevTable {
+    public:
+        ChebyshevTable( const PoleTable &table, double lower, double upper,
+                        int ndegree );
+
+        int dimension() const { return size; }
+
+        // Adds the value of the fit at E into m.
+        template < class M >
+        void evaluate( double E, M &m ) const;
+        // Adds the derivative of the fit at E into m.
+        template < class M >
+        void evaluate_derivative( double E, M &m ) const;
+    private:
+        // The series of length terms at c, at x in [ -1, 1 ].
+        static double sum( const double *c, int terms, double x );
+
+        int    size;
+        int    degree;
+        double center;
+        double half_width;
+        // degree + 1 coefficients for each element of the upper triangle,
+        // row by row, and degree for its derivative in x.
+        std::vector< double > coefficients;
+        std::vector< double > derivative_coefficients;
+};
+
+template < class M >
+void ChebyshevTable::evaluate( double E, M &m ) const {
+    double x = ( E - center ) / half_width;
+    const double *c = coefficients.empty() ? 0 : &coefficients[0];
+    for ( int i = 0; i < size; ++i ) {
+        for ( int k = i; k < size; ++k, c += degree + 1 ) {
+            double value = sum( c, degree + 1, x );
+            m( i, k ) += value;
+            if ( i != k )
+                m( k, i ) += value; } } }
+
+template < class M >
+void ChebyshevTable::evaluate_derivative( double E, M &m ) const {
+    if ( 0 == degree )
+        return;
+    double x = ( E - center ) / half_width;
+    const double *c = derivative_coefficients.empty()
+        ? 0 : &derivative_coefficients[0];
+    for ( int i = 0; i < size; ++i ) {
+        for ( int k = i; k < size; ++k, c += degree ) {
+            double value = sum( c, degree, x ) / half_width;
+            m( i, k ) += value;
+            if ( i != k )
+                m( k, i ) += value; } } }
+
+#endif // _CHEBYSHEV_TABLE_H_
@@ -0,0 +1,51 @@
+#include <cassert>
+
+#include <boost/thread/locks.hpp>
+
+#include "EigenvalueCache.h"
+
+EigenvalueCache::EigenvalueCache( int ncapacity )
+    : capacity( ncapacity ), num_hits( 0 ), num_misses( 0 ) {
+    assert( capacity > 0 ); }
+
+bool EigenvalueCache::find( double E, std::vector< double > &vals ) {
+    boost::lock_guard< boost::mutex > lock( mutex );
+    std::map< double, Entry >::iterator i = entries.find( E );
+    if ( entries.end() == i )
+        return false;
+    ++num_hits;
+    order.splice( order.begin(), order, i->second.used );
+    vals = i->second.vals;
+    return true; }
+
+void EigenvalueCache::insert( double E, const std::vector< double > &vals ) {
+    boost::lock_guard< boost::mutex > lock( mutex );
+    ++num_misses;
+    std::map< double, Entry >::iterator i = entries.find( E );
+    if ( entries.end() != i ) {
+        order.splice( order.begin(), order, i->second.used );
+        return; }
+    if ( static_cast<int>(entries.size()) == capacity ) {
+        entries.erase( order.back() );
+        order.pop_back(); }
+    order.push_front( E );
+    Entry &e = entries[E];
+    e.vals = vals;
+    e.used = order.begin(); }
+
+int EigenvalueCache::hits() const {
+    boost::lock_guard< boost::mutex > lock( mutex );
+    return num_hits; }
+
+int EigenvalueCache::misses() const {
+    boost::lock_guard< boost::mutex > lock( mutex );
+    return num_misses; }
+
+double EigenvalueCache::hit_rate() const {
+    boost::lock_guard< boost::mutex > lock( mutex );
+    int lookups = num_hits + num_misses;
+    return 0 == lookups ? 0 : static_cast<double>( num_hits ) / lookups; }
+
+int EigenvalueCache::size() const {
+    boost::lock_guard< boost::mutex > lock( mutex );
+    return entries.size(); }
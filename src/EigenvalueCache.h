@@ -0,0 +1,61 @@
+#ifndef _EIGENVALUE_CACHE_H_
+#define _EIGENVALUE_CACHE_H_
+/* Memo of the sorted eigenvalues of an ERPA matrix by energy.
+ *
+ * The root search evaluates the problem at the ends and the centres of its
+ * regions, and again at the ends when a root find starts in one of them.
+ * The memo answers the energies that come back.  At most capacity energies
+ * are held; the one used least recently is dropped first.  Hits and misses
+ * are counted, which shows how much the search repeats itself.  A miss is
+ * counted when eigenvalues are inserted, not when find comes back empty, as
+ * the caller may then get by without computing them.
+ *
+ * The cache may be shared by threads.
+ *
+ * Example:
+ *  EigenvalueCache cache( 256 );
+ *  std::vector< double > vals;
+ *  if ( !cache.find( E, vals ) ) {
+ *      vals = util::sorted_eigenvalues( mf.build( E ) );
+ *      cache.insert( E, vals ); }
+ *  std::cout << cache.hit_rate() << std::endl;
+ */
+
+#include <list>
+#include <map>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+
+class EigenvalueCache {
+    public:
+        explicit EigenvalueCache( int ncapacity = 512 );
+
+        // Returns false when E has not been stored, and counts a hit
+        // otherwise.
+        bool find( double E, std::vector< double > &vals );
+        // Counts a miss.
+        void insert( double E, const std::vector< double > &vals );
+
+        int    hits() const;
+        int    misses() const;
+        // hits / ( hits + misses ), 0 before the first hit or insert.
+        double hit_rate() const;
+        int    size() const;
+    private:
+        // Energies, the most recently used first.
+        typedef std::list< double > order_t;
+        struct Entry {
+            std::vector< double > vals;
+            order_t::iterator     used;
+        };
+
+        mutable boost::mutex      mutex;
+        int                       capacity;
+        int                       num_hits;
+        int                       num_misses;
+        std::map< double, Entry > entries;
+        order_t                   order;
+};
+
+#endif // _EIGENVALUE_CACHE_H_
@@ -0,0 +1,186 @@
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/exceptions.hpp>
+
+#include "exceptions.h"
+#include "GMatrixCache.h"
+
+namespace ipc = boost::interprocess;
+
+namespace internal {
+
+// Bumped whenever the layout changes.
+const char gmatrix_magic[8] = { 'G', 'M', 'A', 'T', 'R', 'I', 'X', '1' };
+
+// File layout:  header, num_blocks block sizes (uint64, in tz, parity, J
+// order), then num_values doubles.  Everything is 8 byte aligned.
+struct GMatrixHeader {
+    char            magic[8];
+    boost::uint64_t source_size;
+    boost::int64_t  source_mtime;
+    boost::uint64_t modelspace_hash;
+    boost::uint64_t num_blocks;
+    boost::uint64_t num_values;
+};
+
+// FNV-1a
+void hash_bytes( boost::uint64_t &hash, const void *data, std::size_t size ) {
+    const unsigned char *bytes = static_cast< const unsigned char * >( data );
+    for ( std::size_t i = 0; i < size; ++i ) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL; } }
+
+template < class T >
+void hash_vector( boost::uint64_t &hash, const std::vector< T > &v ) {
+    boost::uint64_t size = v.size();
+    hash_bytes( hash, &size, sizeof( size ) );
+    if ( !v.empty() )
+        hash_bytes( hash, &v[0], v.size() * sizeof( T ) ); }
+
+std::vector< boost::uint64_t > flatten( const Indexsizes &sizes ) {
+    std::vector< boost::uint64_t > result;
+    for ( unsigned int t = 0; t < sizes.size(); ++t ) {
+        for ( unsigned int p = 0; p < sizes[t].size(); ++p ) {
+            result.insert( result.end(), sizes[t][p].begin(),
+                                         sizes[t][p].end() ); } }
+    return result; }
+
+} // end namespace internal
+
+// The matrix elements only depend on the quantum numbers, not on the
+// fragments.
+GMatrixKey make_gmatrix_key( const std::string &source_filename,
+                             const SingleParticleModelspace &spms ) {
+    struct stat info;
+    if ( 0 != stat( source_filename.c_str(), &info ) )
+        throw file_error();
+
+    GMatrixKey key;
+    key.source_size     = info.st_size;
+    // Whole seconds miss a file rewritten within the second it was cached
+    key.source_mtime    = boost::int64_t( info.st_mtim.tv_sec ) * 1000000000
+                        + info.st_mtim.tv_nsec;
+    key.modelspace_hash = 14695981039346656037ULL;
+    internal::hash_vector( key.modelspace_hash, spms.j );
+    internal::hash_vector( key.modelspace_hash, spms.parity );
+    internal::hash_vector( key.modelspace_hash, spms.n );
+    internal::hash_vector( key.modelspace_hash, spms.tz );
+    return key; }
+
+PackedGMatrix::PackedGMatrix( const Indexsizes &nsizes )
+    : sizes( nsizes ), num_values( 0 ), values( 0 ) {
+    build_offsets();
+    storage.reset( new std::vector< double >( num_values, 0.0 ) );
+    if ( num_values )
+        values = &(*storage)[0]; }
+
+void PackedGMatrix::build_offsets() {
+    num_values = 0;
+    offsets.resize( sizes.size() );
+    for ( unsigned int t = 0; t < sizes.size(); ++t ) {
+        offsets[t].resize( sizes[t].size() );
+        for ( unsigned int p = 0; p < sizes[t].size(); ++p ) {
+            offsets[t][p].resize( sizes[t][p].size() );
+            for ( unsigned int J = 0; J < sizes[t][p].size(); ++J ) {
+                std::size_t size = sizes[t][p][J];
+                offsets[t][p][J] = num_values;
+                num_values += size * ( size + 1 ) / 2; } } } }
+
+void PackedGMatrix::set( int tz, int parity, int J, int iA, int iB,
+                         double V ) {
+    assert( storage );
+    (*storage)[ index( tz, parity, J, iA, iB ) ] = V; }
+
+boost::shared_ptr< const PackedGMatrix >
+PackedGMatrix::map_file( const std::string &filename, const GMatrixKey &key,
+                         const Indexsizes &sizes ) {
+    boost::shared_ptr< const PackedGMatrix > none;
+    boost::shared_ptr< ipc::mapped_region > region;
+    try {
+        ipc::file_mapping file( filename.c_str(), ipc::read_only );
+        region.reset( new ipc::mapped_region( file, ipc::read_only ) ); }
+    catch ( const ipc::interprocess_exception & ) {
+        return none; }
+
+    std::vector< boost::uint64_t > block_sizes = internal::flatten( sizes );
+    const char *begin = static_cast< const char * >( region->get_address() );
+    std::size_t length = region->get_size();
+    std::size_t header_length = sizeof( internal::GMatrixHeader )
+        + block_sizes.size() * sizeof( boost::uint64_t );
+    if ( length < header_length )
+        return none;
+
+    const internal::GMatrixHeader *header
+        = reinterpret_cast< const internal::GMatrixHeader * >( begin );
+    if ( 0 != std::memcmp( header->magic, internal::gmatrix_magic, 8 ) ||
+         header->source_size     != key.source_size  ||
+         header->source_mtime    != key.source_mtime ||
+         header->modelspace_hash != key.modelspace_hash ||
+         header->num_blocks      != block_sizes.size() )
+        return none;
+    const boost::uint64_t *stored_sizes
+        = reinterpret_cast< const boost::uint64_t * >( header + 1 );
+    if ( !std::equal( block_sizes.begin(), block_sizes.end(), stored_sizes ) )
+        return none;
+
+    boost::shared_ptr< PackedGMatrix > result( new PackedGMatrix() );
+    result->sizes = sizes;
+    result->build_offsets();
+    if ( header->num_values != result->num_values ||
+         length != header_length + result->num_values * sizeof( double ) )
+        return none;
+    result->region = region;
+    result->values = reinterpret_cast< const double * >(
+            begin + header_length );
+    return result; }
+
+// Written under a temporary name first, so that a partly written file is
+// never mapped.  The name is unique, as other processes may write the same
+// cache at the same time.
+bool PackedGMatrix::write_file( const std::string &filename,
+                                const GMatrixKey &key ) const {
+    std::vector< boost::uint64_t > block_sizes = internal::flatten( sizes );
+    internal::GMatrixHeader header;
+    std::memcpy( header.magic, internal::gmatrix_magic, 8 );
+    header.source_size     = key.source_size;
+    header.source_mtime    = key.source_mtime;
+    header.modelspace_hash = key.modelspace_hash;
+    header.num_blocks      = block_sizes.size();
+    header.num_values      = num_values;
+
+    std::vector< char > name( filename.begin(), filename.end() );
+    const char suffix[] = ".XXXXXX";
+    name.insert( name.end(), suffix, suffix + sizeof( suffix ) );
+    int fd = mkstemp( &name[0] );
+    if ( fd < 0 )
+        return false;
+    // mkstemp creates the file for the owner only
+    fchmod( fd, 0644 );
+    close( fd );
+    std::string temporary( &name[0] );
+    {   std::ofstream file( temporary.c_str(),
+                            std::ios::out | std::ios::binary );
+        file.write( reinterpret_cast< const char * >( &header ),
+                    sizeof( header ) );
+        if ( !block_sizes.empty() )
+            file.write( reinterpret_cast< const char * >( &block_sizes[0] ),
+                        block_sizes.size() * sizeof( boost::uint64_t ) );
+        if ( num_values )
+            file.write( reinterpret_cast< const char * >( values ),
+                        num_values * sizeof( double ) );
+        file.close();
+        if ( file.fail() ) {
+            std::remove( temporary.c_str() );
+            return false; } }
+    if ( 0 != std::rename( temporary.c_str(), filename.c_str() ) ) {
+        std::remove( temporary.c_str() );
+        return false; }
+    return true; }
@@ -0,0 +1,96 @@
+#ifndef _GMATRIX_CACHE_H_
+#define _GMATRIX_CACHE_H_
+/* Binary cache for a parsed G-matrix file.
+ *
+ * The matrix of every ( tz, parity, J ) channel is stored as a packed upper
+ * triangle after a short header.  The header records the size and the
+ * modification time (in nanoseconds) of the source file, and a hash of the
+ * single particle quantum numbers; a cache file that does not match all
+ * three is ignored.
+ * A valid cache file is mapped read only, so loading it involves neither
+ * parsing nor copying.
+ *
+ * Example:
+ *  GMatrixKey key = make_gmatrix_key( "G.mhj", spms );
+ *  boost::shared_ptr< const PackedGMatrix > G
+ *      = PackedGMatrix::map_file( "G.mhj.cache", key, sizes );
+ *  if ( !G ) {
+ *      boost::shared_ptr< PackedGMatrix > parsed( new PackedGMatrix( sizes ) );
+ *      parsed->set( tz, parity, J, iA, iB, V );
+ *      parsed->write_file( "G.mhj.cache", key );
+ *      G = parsed; }
+ *  double V = (*G)( tz, parity, J, iA, iB );
+ */
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include "Modelspace.h"
+
+// Matrix dimension of each channel:  sizes[ tz + 1 ][ (parity+1)/2 ][ J ]
+typedef std::vector< std::vector< std::vector< int > > > Indexsizes;
+
+// Constant public data members allow for a simple interface.
+struct GMatrixKey {
+    boost::uint64_t source_size;
+    boost::int64_t  source_mtime;
+    boost::uint64_t modelspace_hash;
+};
+
+// Throws file_error if the source file does not exist.
+GMatrixKey make_gmatrix_key( const std::string &source_filename,
+                             const SingleParticleModelspace &spms );
+
+class PackedGMatrix {
+    public:
+        // All elements zero, held in memory.
+        explicit PackedGMatrix( const Indexsizes &nsizes );
+
+        // Returns 0 (null) if the file is missing, or does not match key
+        // and sizes.
+        static boost::shared_ptr< const PackedGMatrix >
+        map_file( const std::string &filename, const GMatrixKey &key,
+                  const Indexsizes &sizes );
+
+        // Returns false if the file could not be written.
+        bool write_file( const std::string &filename,
+                         const GMatrixKey &key ) const;
+
+        double operator()( int tz, int parity, int J, int iA, int iB ) const {
+            return values[ index( tz, parity, J, iA, iB ) ]; }
+        // Packed upper triangle of one channel
+        const double *channel( int tz, int parity, int J ) const {
+            return values + offsets[ tz + 1 ][ (parity+1)/2 ][ J ]; }
+        // Only for matricies held in memory.
+        void set( int tz, int parity, int J, int iA, int iB, double V );
+
+        bool is_mapped() const { return 0 != region.get(); }
+    private:
+        PackedGMatrix() : num_values( 0 ), values( 0 ) { }
+        void build_offsets();
+        std::size_t index( int tz, int parity, int J, int iA, int iB ) const;
+
+        Indexsizes                                                 sizes;
+        std::vector< std::vector< std::vector< std::size_t > > >   offsets;
+        std::size_t                                                num_values;
+        boost::shared_ptr< std::vector< double > >                 storage;
+        boost::shared_ptr< boost::interprocess::mapped_region >    region;
+        // Points into storage or region
+        const double                                              *values;
+};
+
+inline std::size_t PackedGMatrix::index( int tz, int parity, int J,
+                                         int iA, int iB ) const {
+    if ( iA > iB )
+        std::swap( iA, iB );
+    // Row iA of the upper triangle starts after iA rows of decreasing length
+    std::size_t size = sizes[ tz + 1 ][ (parity+1)/2 ][ J ];
+    return offsets[ tz + 1 ][ (parity+1)/2 ][ J ]
+         + iA * size - iA * ( iA - 1 ) / 2 + ( iB - iA ); }
+
+#endif // _GMATRIX_CACHE_H_
@@ -0,0 +1,131 @@
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include "Modelspace.h"
+#include "GMatrixCache.h"
+#include "InteractionTable.h"
+
+// --------------------------------------------------------------------
+// PPInteractionTable
+// --------------------------------------------------------------------
+
+PPInteractionTable::PPInteractionTable(
+        const boost::shared_ptr< const PackedGMatrix > &G,
+        const PPIndices &indices,
+        const SingleParticleModelspace &spms ) {
+    boost::shared_ptr< Data > d( new Data );
+    int nsp = spms.size;
+    d->nsp = nsp;
+    d->G   = G;
+
+    d->pair_channel.resize( nsp * nsp );
+    d->phase[0].resize( nsp * nsp );
+    d->phase[1].resize( nsp * nsp );
+    for ( int i = 0; i < nsp; ++i ) {
+        for ( int j = 0; j < nsp; ++j ) {
+            int tz     = spms.tz[ i ]     + spms.tz[ j ];
+            int parity = spms.parity[ i ] * spms.parity[ j ];
+            d->pair_channel[ i * nsp + j ] = get_channel_block( tz, parity );
+            // These phases take care of antisymmetrizing the interaction.
+            double phase = 1;
+            if ( i > j )
+                phase = std::pow( -1.0, spms.j[ i ] - spms.j[ j ] );
+            d->phase[0][ i * nsp + j ] = phase;
+            d->phase[1][ i * nsp + j ] = i > j ? -phase : phase; } }
+
+    d->channels.resize( 6 );
+    for ( int tz = -1; tz <= 1; ++tz ) {
+        for ( int parity = -1; parity <= 1; parity += 2 ) {
+            const std::vector< boost::numeric::ublas::symmetric_matrix< int > >
+                &block = indices[ tz + 1 ][ (parity + 1)/2 ];
+            std::vector< ChannelData > &channels
+                = d->channels[ get_channel_block( tz, parity ) ];
+            channels.resize( block.size() );
+            for ( int J = 0; J < static_cast<int>(block.size()); ++J ) {
+                ChannelData &c = channels[ J ];
+                c.size = 0;
+                c.index.resize( nsp * nsp );
+                for ( int i = 0; i < nsp; ++i ) {
+                    for ( int j = 0; j < nsp; ++j ) {
+                        c.index[ i * nsp + j ] = block[ J ]( i, j );
+                        if ( i <= j && block[ J ]( i, j ) >= 0 )
+                            ++c.size; } }
+                c.values = G->channel( tz, parity, J ); } } }
+    data = d;
+}
+
+void PPInteractionTable::Channel::row( int ia, int ib,
+                                      std::vector< double > &out ) const {
+    int iA = index[ ia * stride + ib ];
+    assert( iA >= 0 );
+    double p = phase[ ia * stride + ib ];
+    out.resize( size );
+    // Column iA of the upper triangle, then the rest of row iA
+    for ( int iB = 0; iB < iA; ++iB ) {
+        out[ iB ] = p * values[ iB * size - iB * ( iB - 1 ) / 2
+                               + ( iA - iB ) ]; }
+    const double *packed = values + iA * size - iA * ( iA - 1 ) / 2 - iA;
+    for ( int iB = iA; iB < size; ++iB ) {
+        out[ iB ] = p * packed[ iB ]; } }
+
+PPInteractionTable::Channel
+PPInteractionTable::channel( int tz, int parity, int J ) const {
+    const ChannelData &c
+        = data->channels[ get_channel_block( tz, parity ) ][ J ];
+    return Channel( c.size, data->nsp, &c.index[0],
+                    &data->phase[ J % 2 ][0], c.values ); }
+
+// --------------------------------------------------------------------
+// PHInteractionTable
+// --------------------------------------------------------------------
+
+PHInteractionTable::PHInteractionTable(
+        const PHIndices &indices,
+        const ParticleHoleModelspace &shells,
+        const SingleParticleModelspace &spms )
+    : data( new Data ) {
+    int nsp = spms.size;
+    data->nsp = nsp;
+
+    data->pair_channel.resize( nsp * nsp );
+    for ( int ip = 0; ip < nsp; ++ip ) {
+        for ( int ih = 0; ih < nsp; ++ih ) {
+            int tz     = spms.tz[ ip ]     - spms.tz[ ih ];
+            int parity = spms.parity[ ip ] * spms.parity[ ih ];
+            data->pair_channel[ ip * nsp + ih ]
+                = get_channel_block( tz, parity ); } }
+
+    data->channels.resize( 6 );
+    for ( int tz = -1; tz <= 1; ++tz ) {
+        for ( int parity = -1; parity <= 1; parity += 2 ) {
+            const std::vector< boost::numeric::ublas::matrix< int > >
+                &block = indices[ tz + 1 ][ (parity + 1)/2 ];
+            std::vector< ChannelData > &channels
+                = data->channels[ get_channel_block( tz, parity ) ];
+            channels.resize( block.size() );
+            for ( int J = 0; J < static_cast<int>(block.size()); ++J ) {
+                ChannelData &c = channels[ J ];
+                c.size = shells[ tz + 1 ][ (parity + 1)/2 ][ J ].size();
+                c.index.resize( nsp * nsp );
+                for ( int ip = 0; ip < nsp; ++ip ) {
+                    for ( int ih = 0; ih < nsp; ++ih ) {
+                        c.index[ ip * nsp + ih ] = block[ J ]( ip, ih ); } }
+                c.elems.assign( c.size * c.size, 0.0 ); } } }
+}
+
+PHInteractionTable::Channel
+PHInteractionTable::channel( int tz, int parity, int J ) const {
+    const ChannelData &c
+        = data->channels[ get_channel_block( tz, parity ) ][ J ];
+    return Channel( c.size, data->nsp, &c.index[0],
+                    c.elems.empty() ? 0 : &c.elems[0] ); }
+
+void PHInteractionTable::set( int tz, int parity, int J, int iA, int iB,
+                              double V ) {
+    ChannelData &c = data->channels[ get_channel_block( tz, parity ) ][ J ];
+    assert( iA < c.size && iB < c.size );
+    c.elems[ iA * c.size + iB ] = V;
+    c.elems[ iB * c.size + iA ] = V; }
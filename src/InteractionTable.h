@@ -0,0 +1,201 @@
+#ifndef _INTERACTION_TABLE_H_
+#define _INTERACTION_TABLE_H_
+/* Concrete PP and PH interactions that the term kernels call directly.
+ *
+ * PPInteraction and PHInteraction are boost::function wrappers, so every
+ * element goes through type erased dispatch, and has to work out the
+ * channel of the states before it can look anything up.  These tables do
+ * that work when they are built: the channel of every single particle pair,
+ * its position in the channel matrix and (for PP) the antisymmetrization
+ * phase are stored in flat arrays, and the lookups are inline.
+ *
+ * Copies share the elements, so tables are cheap to pass by value.  A table
+ * is itself a valid PPInteraction or PHInteraction; as_pp_table and
+ * as_ph_table (see the interaction factories) recover the table from such a
+ * wrapper, or tabulate any other interaction.
+ *
+ * Examples:
+ *  PHInteractionTable Gph = as_ph_table( ph_interaction, spms );
+ *  double V = Gph( ph1, ph2 );
+ *
+ *  // For many elements of one ( tz, parity, J ) channel
+ *  PHInteractionTable::Channel G = Gph.channel( tz, parity, J );
+ *  double V = G( ip, ih, jp, jh );
+ *
+ *  // All elements ( ip, ih, x ) of the channel, by position of x
+ *  const double *row = G.row( ip, ih );
+ *  double V = row[ G.position( jp, jh ) ];
+ */
+
+#include <cassert>
+#include <vector>
+#include <algorithm>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/numeric/ublas/matrix.hpp>
+#include <boost/numeric/ublas/symmetric.hpp>
+
+#include "Modelspace.h"
+#include "GMatrixCache.h"
+
+// Format: indices[tz+1][(parity+1)/2][J]( ip1, ip2 )
+typedef std::vector< std::vector< std::vector<
+    boost::numeric::ublas::symmetric_matrix< int >
+> > > PPIndices;
+
+// Format: indices[tz+1][(parity+1)/2][J]( ip, ih )
+typedef std::vector< std::vector< std::vector<
+    boost::numeric::ublas::matrix< int >
+> > > PHIndices;
+
+class PPInteractionTable {
+    public:
+        class Channel {
+            public:
+                Channel()
+                    : size( 0 ), stride( 0 ), index( 0 ), phase( 0 ),
+                      values( 0 ) { }
+                Channel( int nsize, int nstride, const int *nindex,
+                         const double *nphase, const double *nvalues )
+                    : size( nsize ), stride( nstride ), index( nindex ),
+                      phase( nphase ), values( nvalues ) { }
+                double operator()( int ia, int ib, int ic, int id ) const;
+
+                int dimension() const { return size; }
+                int position( int ia, int ib ) const {
+                    return index[ ia * stride + ib ]; }
+                // Elements ( ia, ib, ic, id ) with ic <= id, by position.
+                void row( int ia, int ib, std::vector< double > &out ) const;
+            private:
+                int           size;
+                int           stride;
+                const int    *index;
+                const double *phase;
+                // Packed upper triangle
+                const double *values;
+        };
+
+        PPInteractionTable() { }
+        PPInteractionTable( const boost::shared_ptr< const PackedGMatrix > &G,
+                            const PPIndices &indices,
+                            const SingleParticleModelspace &spms );
+
+        double operator()( const ParticleParticleState &A,
+                           const ParticleParticleState &B ) const;
+        Channel channel( int tz, int parity, int J ) const;
+    private:
+        struct ChannelData {
+            int                size;
+            std::vector< int > index;
+            const double      *values;
+        };
+        struct Data {
+            int                                          nsp;
+            std::vector< int >                           pair_channel;
+            // phase[ J % 2 ][ ip1 * nsp + ip2 ]
+            std::vector< double >                        phase[2];
+            std::vector< std::vector< ChannelData > >    channels;
+            boost::shared_ptr< const PackedGMatrix >     G;
+        };
+        boost::shared_ptr< const Data > data;
+};
+
+class PHInteractionTable {
+    public:
+        class Channel {
+            public:
+                Channel() : size( 0 ), stride( 0 ), index( 0 ), elems( 0 ) { }
+                Channel( int nsize, int nstride, const int *nindex,
+                         const double *nelems )
+                    : size( nsize ), stride( nstride ), index( nindex ),
+                      elems( nelems ) { }
+                double operator()( int ip, int ih, int jp, int jh ) const;
+
+                int dimension() const { return size; }
+                int position( int ip, int ih ) const {
+                    return index[ ip * stride + ih ]; }
+                // Elements ( ip, ih, jp, jh ), by position of ( jp, jh ).
+                const double *row( int ip, int ih ) const {
+                    return elems + position( ip, ih ) * size; }
+            private:
+                int           size;
+                int           stride;
+                const int    *index;
+                // Both triangles, row major
+                const double *elems;
+        };
+
+        PHInteractionTable() { }
+        // All elements are zero until they are set.
+        PHInteractionTable( const PHIndices &indices,
+                            const ParticleHoleModelspace &shells,
+                            const SingleParticleModelspace &spms );
+
+        double operator()( const ParticleHoleState &A,
+                           const ParticleHoleState &B ) const;
+        Channel channel( int tz, int parity, int J ) const;
+
+        // Only while the table is being built; sets ( iA, iB ) and
+        // ( iB, iA ).  Different elements may be set concurrently.
+        void set( int tz, int parity, int J, int iA, int iB, double V );
+    private:
+        struct ChannelData {
+            int                   size;
+            std::vector< int >    index;
+            std::vector< double > elems;
+        };
+        struct Data {
+            int                                          nsp;
+            std::vector< int >                           pair_channel;
+            std::vector< std::vector< ChannelData > >    channels;
+        };
+        boost::shared_ptr< Data > data;
+};
+
+// Position of a ( tz, parity ) block in the flat channel lists.
+inline int get_channel_block( int tz, int parity ) {
+    return 2 * ( tz + 1 ) + ( parity + 1 ) / 2; }
+
+inline double
+PPInteractionTable::Channel::operator()( int ia, int ib,
+                                         int ic, int id ) const {
+    int iA = index[ ia * stride + ib ];
+    int iB = index[ ic * stride + id ];
+    assert( iA >= 0 && iB >= 0 );
+    if ( iA > iB )
+        std::swap( iA, iB );
+    return phase[ ia * stride + ib ] * phase[ ic * stride + id ]
+         * values[ iA * size - iA * ( iA - 1 ) / 2 + ( iB - iA ) ]; }
+
+inline double
+PPInteractionTable::operator()( const ParticleParticleState &A,
+                                const ParticleParticleState &B ) const {
+    assert( A.J == B.J );
+    int nsp = data->nsp;
+    int iAB = A.ip1 * nsp + A.ip2;
+    assert( data->pair_channel[ iAB ]
+            == data->pair_channel[ B.ip1 * nsp + B.ip2 ] );
+    const ChannelData &c = data->channels[ data->pair_channel[ iAB ] ][ A.J ];
+    return Channel( c.size, nsp, &c.index[0], &data->phase[ A.J % 2 ][0],
+                    c.values )( A.ip1, A.ip2, B.ip1, B.ip2 ); }
+
+inline double
+PHInteractionTable::Channel::operator()( int ip, int ih,
+                                         int jp, int jh ) const {
+    int iA = index[ ip * stride + ih ];
+    int iB = index[ jp * stride + jh ];
+    assert( iA >= 0 && iB >= 0 );
+    return elems[ iA * size + iB ]; }
+
+inline double
+PHInteractionTable::operator()( const ParticleHoleState &A,
+                                const ParticleHoleState &B ) const {
+    assert( A.J == B.J );
+    int nsp = data->nsp;
+    int iAB = A.ip * nsp + A.ih;
+    assert( data->pair_channel[ iAB ]
+            == data->pair_channel[ B.ip * nsp + B.ih ] );
+    const ChannelData &c = data->channels[ data->pair_channel[ iAB ] ][ A.J ];
+    return c.elems[ c.index[ iAB ] * c.size + c.index[ B.ip * nsp + B.ih ] ]; }
+
+#endif // _INTERACTION_TABLE_H_
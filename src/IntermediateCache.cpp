@@ -0,0 +1,30 @@
+#include <boost/tuple/tuple.hpp>
+#include <boost/tuple/tuple_comparison.hpp>
+#include <boost/thread/locks.hpp>
+
+#include "IntermediateCache.h"
+
+bool IntermediateKey::operator<( const IntermediateKey &sister ) const {
+    return boost::tie( a, b, c, d, af, bf, cf, df, Jp )
+         < boost::tie( sister.a,  sister.b,  sister.c,  sister.d,
+                       sister.af, sister.bf, sister.cf, sister.df,
+                       sister.Jp ); }
+
+IntermediateKey IntermediateKey::shells() const {
+    return IntermediateKey( a, b, c, d, -1, -1, -1, -1, Jp ); }
+
+const ShellIntermediate *IntermediateCache::find_shell(
+        const IntermediateKey &key ) const {
+    boost::shared_lock< boost::shared_mutex > lock( mutex );
+    std::map< IntermediateKey, ShellIntermediate >::const_iterator i
+        = shell_sums.find( key );
+    return shell_sums.end() == i ? 0 : &i->second; }
+
+const ShellIntermediate &IntermediateCache::insert_shell(
+        const IntermediateKey &key, const ShellIntermediate &s ) {
+    boost::unique_lock< boost::shared_mutex > lock( mutex );
+    return shell_sums.insert( std::make_pair( key, s ) ).first->second; }
+
+int IntermediateCache::size() const {
+    boost::shared_lock< boost::shared_mutex > lock( mutex );
+    return shell_sums.size(); }
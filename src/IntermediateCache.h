@@ -0,0 +1,69 @@
+#ifndef _INTERMEDIATE_CACHE_H_
+#define _INTERMEDIATE_CACHE_H_
+/* Storage for the recoupled intermediate sums of the screening and ladder
+ * terms.
+ *
+ * For a given Jp the sum over intermediate states depends on the four
+ * external shells, their fragments and Jp, but not on the total J of the
+ * channel.  Keeping the sums here lets every J channel of a run share them.
+ *
+ * The products of interaction elements in the sums depend only on the
+ * shells.  Only those sums are stored, once per shell key (fragments -1),
+ * with the poles at the intermediate energies alone; the fragments of the
+ * external states only shift the poles and pick the denominators, which is
+ * cheap to redo for every element.  The cache so grows with the number of
+ * shells, not of fragments.
+ *
+ * The cache may be shared by threads working on different channels; any
+ * number of them may look entries up at once.  Stored entries are never
+ * changed, so the returned references remain valid.
+ *
+ * Example:
+ *  IntermediateKey key( a, b, c, d, af, bf, cf, df, Jp );
+ *  const ShellIntermediate *shell = cache.find_shell( key.shells() );
+ *  if ( !shell )
+ *      shell = &cache.insert_shell( key.shells(), ... );
+ */
+
+#include <map>
+
+#include <boost/thread/shared_mutex.hpp>
+
+#include "PoleTable.h"
+
+// Constant public data members allow for a simple interface.
+struct IntermediateKey {
+    IntermediateKey( int na,  int nb,  int nc,  int nd,
+                     int naf, int nbf, int ncf, int ndf, int nJp )
+        : a( na ), b( nb ), c( nc ), d( nd ),
+          af( naf ), bf( nbf ), cf( ncf ), df( ndf ), Jp( nJp ) { }
+    int a, b, c, d;
+    int af, bf, cf, df;
+    int Jp;
+    bool operator<( const IntermediateKey &sister ) const;
+    // The same key with every fragment index -1.
+    IntermediateKey shells() const;
+};
+
+// Sums over the forward and backward going intermediate states of a shell
+// key.  Constant public data members allow for a simple interface.
+struct ShellIntermediate {
+    PoleSum forward;
+    PoleSum backward;
+};
+
+class IntermediateCache {
+    public:
+        // Return 0 when the key has not been stored yet.
+        const ShellIntermediate *find_shell( const IntermediateKey &key ) const;
+        const ShellIntermediate &insert_shell( const IntermediateKey &key,
+                                               const ShellIntermediate &s );
+
+        int size() const;
+    private:
+        // Lookups share the lock; only insert_shell takes it alone.
+        mutable boost::shared_mutex                    mutex;
+        std::map< IntermediateKey, ShellIntermediate > shell_sums;
+};
+
+#endif // _INTERMEDIATE_CACHE_H_
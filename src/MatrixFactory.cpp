@@ -1,29 +1,414 @@
+#include <cmath>
+#include <algorithm>
+
 #include <boost/foreach.hpp>
+#include <boost/bind.hpp>
 #include <boost/numeric/ublas/matrix_proxy.hpp>
 #include <boost/numeric/ublas/io.hpp>
 
 #include "linalg.h"
+#include "PoleTable.h"
 #include "Term.h"
 #include "MatrixFactory.h"
+#include "scheduler.h"
+
+namespace internal {
+
+// One auxiliary state of the linearized problem:  the pole energy, the
+// residue weight d and the column u (in the full matrix) of K = U D U^T.
+struct PoleState {
+    PoleState( double nP, double nd, const util::vector_t &nu )
+        : P( nP ), d( nd ), u( nu ) { }
+    double         P;
+    double         d;
+    util::vector_t u;
+};
+
+// A single residue R of element ( i, k ) at pole energy E.
+struct Residue {
+    Residue( double nE, int ni, int nk, double nR )
+        : E( nE ), i( ni ), k( nk ), R( nR ) { }
+    double E;
+    int    i, k;
+    double R;
+    bool operator<( const Residue &sister ) const {
+        return E < sister.E; }
+};
+
+// Relative distance below which pole energies are treated as one pole.
+const double pole_tolerance = 1e-12;
+// Relative size below which residue eigenvalues are dropped.
+const double rank_tolerance = 1e-12;
+
+// The residues of every element of table, sorted by energy.
+std::vector< Residue > sorted_residues( const PoleTable &table ) {
+    std::vector< Residue > residues;
+    for ( int i = 0; i < table.dimension(); ++i ) {
+        for ( int k = i; k < table.dimension(); ++k ) {
+            BOOST_FOREACH( const Pole &p, table( i, k ).poles ) {
+                residues.push_back( Residue( p.E, i, k, p.R ) ); } } }
+    std::sort( residues.begin(), residues.end() );
+    return residues; }
+
+// One past the last residue of the pole starting at residues[first].
+std::size_t pole_end( const std::vector< Residue > &residues,
+                      std::size_t first ) {
+    std::size_t last = first + 1;
+    while ( last < residues.size() &&
+            residues[last].E - residues[first].E
+                <= pole_tolerance * ( 1 + std::abs( residues[first].E ) ) )
+        ++last;
+    return last; }
+
+// The sorted rows touched by the residues in [ first, last ).
+std::vector< int > pole_rows( const std::vector< Residue > &residues,
+                              std::size_t first, std::size_t last ) {
+    std::vector< int > rows;
+    for ( std::size_t r = first; r < last; ++r ) {
+        rows.push_back( residues[r].i );
+        rows.push_back( residues[r].k ); }
+    std::sort( rows.begin(), rows.end() );
+    rows.erase( std::unique( rows.begin(), rows.end() ), rows.end() );
+    return rows; }
+
+// The number of rows touched by every pole of table; no pole splits into
+// more rank one parts than that.
+int count_pole_rows( const PoleTable &table ) {
+    std::vector< Residue > residues = sorted_residues( table );
+    int count = 0;
+    for ( std::size_t first = 0; first < residues.size(); ) {
+        std::size_t last = pole_end( residues, first );
+        count += pole_rows( residues, first, last ).size();
+        first = last; }
+    return count; }
+
+// Splits the residue matrix of every pole of table into rank one parts,
+// placing the table at ( offset, offset ) of a matrix of size full_size.
+void add_pole_states( const PoleTable &table, int offset, int full_size,
+                      std::vector< PoleState > &states ) {
+    std::vector< Residue > residues = sorted_residues( table );
+
+    std::size_t first = 0;
+    while ( first < residues.size() ) {
+        std::size_t last = pole_end( residues, first );
+
+        // Only the rows touched by this pole take part.
+        std::vector< int > rows = pole_rows( residues, first, last );
+
+        util::matrix_t K( rows.size(), rows.size() );
+        K.clear();
+        for ( std::size_t r = first; r < last; ++r ) {
+            int a = std::lower_bound( rows.begin(), rows.end(),
+                                      residues[r].i ) - rows.begin();
+            int b = std::lower_bound( rows.begin(), rows.end(),
+                                      residues[r].k ) - rows.begin();
+            K( a, b ) += residues[r].R;
+            if ( a != b )
+                K( b, a ) += residues[r].R; }
+
+        std::pair< util::vector_t, util::matrix_t > eig
+            = util::symmetric_eig( K );
+        double largest = std::max( std::abs( eig.first( 0 ) ),
+                std::abs( eig.first( eig.first.size() - 1 ) ) );
+        for ( unsigned int n = 0; n < eig.first.size(); ++n ) {
+            if ( std::abs( eig.first( n ) ) <= rank_tolerance * largest )
+                continue;
+            util::vector_t u( full_size );
+            u.clear();
+            for ( unsigned int r = 0; r < rows.size(); ++r ) {
+                u( offset + rows[r] ) = eig.second( r, n ); }
+            states.push_back( PoleState( residues[first].E,
+                                         eig.first( n ), u ) ); }
+        first = last; } }
+
+// Adds the constant parts of table at ( offset, offset ).
+void add_constants( const PoleTable &table, int offset, util::matrix_t &m ) {
+    for ( int i = 0; i < table.dimension(); ++i ) {
+        for ( int k = i; k < table.dimension(); ++k ) {
+            double value = table( i, k ).constant;
+            m( offset + i, offset + k ) += value;
+            if ( i != k )
+                m( offset + k, offset + i ) += value; } } }
+
+// Energies built together by sorted_eigenvalues.  Enough to share the
+// passes over the pole tables, few enough to keep the matrices small.
+const int energy_batch = 16;
+
+// m is not needed afterwards, and is freed while the rest of its batch runs.
+void diagonalize( util::matrix_t &m, std::vector< double > &vals ) {
+    vals = util::sorted_eigenvalues( m );
+    util::matrix_t empty;
+    m.swap( empty ); }
+
+// Builds the matrices of E[first] .. E[last - 1] together, and hands their
+// diagonalizations to the pool.  The worker that built them takes them
+// first, so only the batches being worked on hold matrices.
+void diagonalize_batch( TaskPool &pool, const MatrixFactory &mf,
+                        const std::vector< double > &E, int first, int last,
+                        std::vector< util::matrix_t > &matrices,
+                        std::vector< std::vector< double > > &result ) {
+    mf.build( std::vector< double >( E.begin() + first, E.begin() + last ),
+              matrices );
+    for ( int n = first; n < last; ++n ) {
+        pool.submit( boost::bind( diagonalize,
+                    boost::ref( matrices[ n - first ] ),
+                    boost::ref( result[n] ) ) ); } }
+
+} // end namespace internal
+
+MatrixFactory::MatrixFactory(
+        const util::matrix_t                   &nstatic_matrix,
+        const std::vector< Term >              &ndynamic_terms,
+        const std::vector< ParticleHoleState > &nph_states,
+        int nJ, int nparity, int ntz )
+    : static_matrix( new util::matrix_t( nstatic_matrix ) ),
+      dynamic_terms( ndynamic_terms ),
+      A_poles( new PoleTable( nph_states.size() ) ),
+      A_star_poles( new PoleTable( nph_states.size() ) ),
+      ph_states( new ph_states_t( nph_states ) ),
+      eigenvalues( new EigenvalueCache() ),
+      rpa_structure( util::has_rpa_structure( nstatic_matrix ) ),
+      J( nJ ), parity( nparity ), tz( ntz ) {
+    check();
+}
+
+MatrixFactory::MatrixFactory(
+        const util::matrix_t                   &nstatic_matrix,
+        const std::vector< PoleTerm >          &pole_terms,
+        const std::vector< ParticleHoleState > &nph_states,
+        int nJ, int nparity, int ntz )
+    : static_matrix( new util::matrix_t( nstatic_matrix ) ),
+      ph_states( new ph_states_t( nph_states ) ),
+      eigenvalues( new EigenvalueCache() ),
+      rpa_structure( util::has_rpa_structure( nstatic_matrix ) ),
+      J( nJ ), parity( nparity ), tz( ntz ) {
+    check();
+
+    boost::shared_ptr< PoleTable > A( new PoleTable( nph_states.size() ) );
+    boost::shared_ptr< PoleTable > A_star(
+            new PoleTable( nph_states.size() ) );
+    BOOST_FOREACH( const PoleTerm &t, pole_terms ) {
+        t( *ph_states, *A, *A_star ); }
+    A->compress();
+    A_star->compress();
+    A_poles      = A;
+    A_star_poles = A_star;
+}
+
+void MatrixFactory::check() const {
+    assert( J >= 0 );
+    assert( 1 == parity || -1 == parity );
+    assert( 1 >= tz && -1 <= tz );
+    assert( static_matrix->size1() == static_matrix->size2() );
+    assert( 2 * ph_states->size()  == static_matrix->size1() );
+}
 
 util::matrix_t
 MatrixFactory::build( double E ) const {
+    util::matrix_t result( static_matrix->size1(), static_matrix->size2() );
+    build( E, result );
+    return result;
+}
+
+void
+MatrixFactory::build( double E, util::matrix_t &result ) const {
     // Copy the static elements
-    util::matrix_t result( static_matrix );
+    result = *static_matrix;
 
     // Generate the dynamic elements
     int size = result.size1() / 2;
     ublas::range first_half( 0, size );
     ublas::range second_half( size, 2*size );
 
-    typedef ublas::matrix_range< util::matrix_t > submatrix_t;
-    submatrix_t A     ( result, first_half,  first_half );
-    submatrix_t A_star( result, second_half, second_half );
+    TermBlock::block_t A     ( result, first_half,  first_half );
+    TermBlock::block_t A_star( result, second_half, second_half );
+
+    TermBlock A_block     ( ENUM_A,      A );
+    TermBlock A_star_block( ENUM_A_STAR, A_star, -1 );
+    BOOST_FOREACH( const Term &t, dynamic_terms ) {
+        t( *ph_states, E, A_block );
+        t( *ph_states, E, A_star_block );
+    }
+    A_poles->evaluate( E, A );
+    A_star_poles->evaluate( E, A_star );
+    if ( is_surrogate() ) {
+        A_fit->evaluate( E, A );
+        A_star_fit->evaluate( E, A_star ); }
+}
+
+void
+MatrixFactory::build( const std::vector< double > &E,
+                      std::vector< util::matrix_t > &result ) const {
+    result.assign( E.size(), *static_matrix );
+
+    int size = static_matrix->size1() / 2;
+    ublas::range first_half( 0, size );
+    ublas::range second_half( size, 2*size );
+
+    std::vector< TermBlock::block_t > A, A_star;
+    for ( unsigned int e = 0; e < E.size(); ++e ) {
+        A.push_back( TermBlock::block_t( result[e], first_half, first_half ) );
+        A_star.push_back(
+                TermBlock::block_t( result[e], second_half, second_half ) );
+
+        TermBlock A_block     ( ENUM_A,      A.back() );
+        TermBlock A_star_block( ENUM_A_STAR, A_star.back(), -1 );
+        BOOST_FOREACH( const Term &t, dynamic_terms ) {
+            t( *ph_states, E[e], A_block );
+            t( *ph_states, E[e], A_star_block ); } }
+    A_poles->evaluate( E, A );
+    A_star_poles->evaluate( E, A_star );
+    if ( is_surrogate() ) {
+        for ( unsigned int e = 0; e < E.size(); ++e ) {
+            A_fit->evaluate( E[e], A[e] );
+            A_star_fit->evaluate( E[e], A_star[e] ); } }
+}
+
+util::matrix_t
+MatrixFactory::build_derivative( double E ) const {
+    util::matrix_t result( static_matrix->size1(), static_matrix->size2() );
+    result.clear();
+
+    int size = result.size1() / 2;
+    ublas::range first_half( 0, size );
+    ublas::range second_half( size, 2*size );
+
+    TermBlock::block_t A     ( result, first_half,  first_half );
+    TermBlock::block_t A_star( result, second_half, second_half );
 
+    // Central difference, with A* entering with a minus sign
+    const double h = 1e-6;
+    const double w = 1 / ( 2 * h );
+    TermBlock A_plus      ( ENUM_A,      A,       w );
+    TermBlock A_minus     ( ENUM_A,      A,      -w );
+    TermBlock A_star_plus ( ENUM_A_STAR, A_star, -w );
+    TermBlock A_star_minus( ENUM_A_STAR, A_star,  w );
     BOOST_FOREACH( const Term &t, dynamic_terms ) {
-        A      += t( ph_states, E, ENUM_A );
-        A_star -= t( ph_states, E, ENUM_A_STAR );
+        t( *ph_states, E + h, A_plus );
+        t( *ph_states, E - h, A_minus );
+        t( *ph_states, E + h, A_star_plus );
+        t( *ph_states, E - h, A_star_minus );
     }
+    A_poles->evaluate_derivative( E, A );
+    A_star_poles->evaluate_derivative( E, A_star );
+    if ( is_surrogate() ) {
+        A_fit->evaluate_derivative( E, A );
+        A_star_fit->evaluate_derivative( E, A_star ); }
+    return result;
+}
+
+std::vector< double >
+MatrixFactory::sorted_eigenvalues( double E ) const {
+    std::vector< double > result;
+    if ( !eigenvalues->find( E, result ) ) {
+        result = util::sorted_eigenvalues( build( E ) );
+        eigenvalues->insert( E, result ); }
+    return result;
+}
+
+std::vector< std::vector< double > >
+MatrixFactory::sorted_eigenvalues( const std::vector< double > &E,
+                                   int num_threads ) const {
+    std::vector< std::vector< double > > result( E.size() );
+    std::vector< int >    missing;
+    std::vector< double > missing_E;
+    for ( unsigned int e = 0; e < E.size(); ++e ) {
+        if ( !eigenvalues->find( E[e], result[e] ) ) {
+            missing.push_back( e );
+            missing_E.push_back( E[e] ); } }
+
+    std::vector< std::vector< double > > computed
+        = compute_sorted_eigenvalues( missing_E, num_threads );
+    for ( unsigned int n = 0; n < missing.size(); ++n ) {
+        result[ missing[n] ].swap( computed[n] );
+        eigenvalues->insert( missing_E[n], result[ missing[n] ] ); }
+    return result;
+}
+
+std::vector< std::vector< double > >
+MatrixFactory::compute_sorted_eigenvalues( const std::vector< double > &E,
+                                           int num_threads ) const {
+    std::vector< std::vector< double > > result( E.size() );
+    int size = E.size();
+    std::vector< std::vector< util::matrix_t > > matrices(
+            ( size + internal::energy_batch - 1 ) / internal::energy_batch );
+    TaskPool pool( num_threads );
+    for ( int first = 0; first < size; first += internal::energy_batch ) {
+        pool.submit( boost::bind( internal::diagonalize_batch,
+                    boost::ref( pool ), boost::cref( *this ), boost::cref( E ),
+                    first, std::min( first + internal::energy_batch, size ),
+                    boost::ref( matrices[ first / internal::energy_batch ] ),
+                    boost::ref( result ) ) ); }
+    pool.run();
+    return result;
+}
+
+util::matrix_t
+MatrixFactory::build_linearized() const {
+    assert( dynamic_terms.empty() );
+    assert( !is_surrogate() );
+    int size = static_matrix->size1();
+
+    std::vector< internal::PoleState > states;
+    internal::add_pole_states( *A_poles,      0,        size, states );
+    internal::add_pole_states( *A_star_poles, size / 2, size, states );
+
+    int full_size = size + states.size();
+    util::matrix_t result( full_size, full_size );
+    result.clear();
+
+    ublas::range ph( 0, size );
+    ublas::matrix_range< util::matrix_t > M0( result, ph, ph );
+    M0 = *static_matrix;
+    internal::add_constants( *A_poles,      0,        result );
+    internal::add_constants( *A_star_poles, size / 2, result );
+
+    for ( int n = 0; n < static_cast<int>(states.size()); ++n ) {
+        const internal::PoleState &s = states[n];
+        for ( int i = 0; i < size; ++i ) {
+            result( i, size + n ) = s.u( i );
+            result( size + n, i ) = s.d * s.u( i ); }
+        result( size + n, size + n ) = s.P; }
+    return result;
+}
+
+int MatrixFactory::linearized_size_bound() const {
+    assert( dynamic_terms.empty() );
+    assert( !is_surrogate() );
+    return static_matrix->size1() + internal::count_pole_rows( *A_poles )
+        + internal::count_pole_rows( *A_star_poles );
+}
+
+std::vector< double >
+MatrixFactory::asymptotes( double Emax, double tolerance ) const {
+    assert( dynamic_terms.empty() );
+    std::vector< Pole > poles;
+    A_poles->collect_poles( poles );
+    A_star_poles->collect_poles( poles );
+    return pole_asymptotes( poles, 0, Emax, tolerance );
+}
+
+MatrixFactory
+MatrixFactory::surrogate( double lower, double upper, int degree ) const {
+    assert( dynamic_terms.empty() );
+    assert( !is_surrogate() );
+    double margin = 0.25 * ( upper - lower );
+
+    boost::shared_ptr< PoleTable > A_near( new PoleTable ),
+                                   A_far( new PoleTable ),
+                                   A_star_near( new PoleTable ),
+                                   A_star_far( new PoleTable );
+    A_poles->split( lower - margin, upper + margin, *A_near, *A_far );
+    A_star_poles->split( lower - margin, upper + margin,
+                         *A_star_near, *A_star_far );
+
+    MatrixFactory result( *this );
+    result.A_poles      = A_near;
+    result.A_star_poles = A_star_near;
+    result.A_fit.reset( new ChebyshevTable( *A_far, lower, upper, degree ) );
+    result.A_star_fit.reset(
+            new ChebyshevTable( *A_star_far, lower, upper, degree ) );
+    result.eigenvalues.reset( new EigenvalueCache() );
     return result;
 }
 
@@ -35,20 +420,24 @@ build_static_rpa_matrix( const std::vector< Term > &terms,
     util::matrix_t m( 2 * size, 2 * size );
     m.clear();
 
-    typedef ublas::matrix_range< util::matrix_t > submatrix_t;
     ublas::range first_half( 0, size );
     ublas::range second_half( size, 2*size );
 
-    submatrix_t A     ( m, first_half,  first_half );
-    submatrix_t A_star( m, second_half, second_half );
-    submatrix_t B     ( m, second_half, first_half );
-    submatrix_t B_star( m, first_half,  second_half );
+    TermBlock::block_t all_A     ( m, first_half,  first_half );
+    TermBlock::block_t all_A_star( m, second_half, second_half );
+    TermBlock::block_t all_B     ( m, second_half, first_half );
+    TermBlock::block_t all_B_star( m, first_half,  second_half );
+
+    TermBlock A     ( ENUM_A,      all_A );
+    TermBlock A_star( ENUM_A_STAR, all_A_star, -1 );
+    TermBlock B     ( ENUM_B,      all_B );
+    TermBlock B_star( ENUM_B_STAR, all_B_star, -1 );
 
     BOOST_FOREACH( const Term &t, terms ) {
-        A      += t( ph_states, 0, ENUM_A );
-        B      += t( ph_states, 0, ENUM_B );
-        A_star -= t( ph_states, 0, ENUM_A_STAR );
-        B_star -= t( ph_states, 0, ENUM_B_STAR ); }
+        t( ph_states, 0, A );
+        t( ph_states, 0, B );
+        t( ph_states, 0, A_star );
+        t( ph_states, 0, B_star ); }
     return m; }
 
 util::matrix_t
@@ -60,22 +449,26 @@ build_static_erpa_matrix( const std::vector< Term > &static_terms,
     util::matrix_t m( 2 * size, 2 * size );
     m.clear();
 
-    typedef ublas::matrix_range< util::matrix_t > submatrix_t;
     ublas::range first_half( 0, size );
     ublas::range second_half( size, 2*size );
 
-    submatrix_t A     ( m, first_half,  first_half );
-    submatrix_t A_star( m, second_half, second_half );
-    submatrix_t B     ( m, second_half, first_half );
-    submatrix_t B_star( m, first_half,  second_half );
+    TermBlock::block_t all_A     ( m, first_half,  first_half );
+    TermBlock::block_t all_A_star( m, second_half, second_half );
+    TermBlock::block_t all_B     ( m, second_half, first_half );
+    TermBlock::block_t all_B_star( m, first_half,  second_half );
+
+    TermBlock A     ( ENUM_A,      all_A );
+    TermBlock A_star( ENUM_A_STAR, all_A_star, -1 );
+    TermBlock B     ( ENUM_B,      all_B );
+    TermBlock B_star( ENUM_B_STAR, all_B_star, -1 );
 
     BOOST_FOREACH( const Term &t, static_terms ) {
-        A      += t( ph_states, 0, ENUM_A );
-        B      += t( ph_states, 0, ENUM_B );
-        A_star -= t( ph_states, 0, ENUM_A_STAR );
-        B_star -= t( ph_states, 0, ENUM_B_STAR ); }
+        t( ph_states, 0, A );
+        t( ph_states, 0, B );
+        t( ph_states, 0, A_star );
+        t( ph_states, 0, B_star ); }
 
     BOOST_FOREACH( const Term &t, dynamic_terms ) {
-        B      += t( ph_states, 0, ENUM_B );
-        B_star -= t( ph_states, 0, ENUM_B_STAR ); }
+        t( ph_states, 0, B );
+        t( ph_states, 0, B_star ); }
     return m; }
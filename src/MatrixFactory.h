@@ -3,32 +3,110 @@
 
 #include <vector>
 
+#include <boost/shared_ptr.hpp>
+
 #include "linalg.h"
+#include "EigenvalueCache.h"
 #include "Modelspace.h"
+#include "PoleTable.h"
+#include "ChebyshevTable.h"
 #include "Term.h"
 
+// The static matrix, the ph states and the pole tables are held once and
+// shared by copies of a factory; none of them change after construction.
+// The copies also share one cache of eigenvalues.
 class MatrixFactory {
     public:
         MatrixFactory( const util::matrix_t                   &nstatic_matrix,
                        const std::vector< Term >              &ndynamic_terms,
-                       const SingleParticleModelspace         &nspms,
                        const std::vector< ParticleHoleState > &nph_states,
-                       int nJ, int nparity, int ntz )
-            : static_matrix( nstatic_matrix ), dynamic_terms( ndynamic_terms ),
-              ph_states( nph_states ), spms( nspms ),
-              J( nJ ), parity( nparity ), tz( ntz ) {
-                  assert( J >= 0 );
-                  assert( 1 == parity || -1 == parity );
-                  assert( 1 >= tz && -1 <= tz );
-                  assert( static_matrix.size1() == static_matrix.size2() );
-                  assert( 2 * ph_states.size()  == static_matrix.size1() );
-              }
+                       int nJ, int nparity, int ntz );
+        // Tabulates the dynamic terms once, so that build only has to sum
+        // the poles of each element.
+        MatrixFactory( const util::matrix_t                   &nstatic_matrix,
+                       const std::vector< PoleTerm >          &pole_terms,
+                       const std::vector< ParticleHoleState > &nph_states,
+                       int nJ, int nparity, int ntz );
         util::matrix_t build( double E ) const;
+        // As above, reusing the storage of result.
+        void build( double E, util::matrix_t &result ) const;
+        // build( E[e] ) into result[e] for every e.  The pole tables are
+        // summed for all the energies in one pass.
+        void build( const std::vector< double > &E,
+                    std::vector< util::matrix_t > &result ) const;
+        // d build / d E.  Only the dynamic A and A* blocks depend on E.  The
+        // tabulated terms are differentiated exactly, the direct terms by a
+        // central difference.
+        util::matrix_t build_derivative( double E ) const;
+
+        // The sorted eigenvalues of build( E ), kept for the energies used
+        // most recently.
+        std::vector< double > sorted_eigenvalues( double E ) const;
+        // The same for many energies.  Energies not in the cache are found
+        // by compute_sorted_eigenvalues.
+        std::vector< std::vector< double > >
+        sorted_eigenvalues( const std::vector< double > &E,
+                            int num_threads = 1 ) const;
+        // The sorted eigenvalues of build( E[e] ) for every e, bypassing the
+        // cache.  The energies are built a batch at a time; the batches and
+        // their diagonalizations are tasks of one run on num_threads
+        // threads.
+        std::vector< std::vector< double > >
+        compute_sorted_eigenvalues( const std::vector< double > &E,
+                                    int num_threads = 1 ) const;
+        EigenvalueCache &eigenvalue_cache() const { return *eigenvalues; }
+
+        // Linear eigenproblem with the same (non-pole) solutions as
+        // build( E ) x = E x.  Each pole P of the tables, with residue
+        // matrix K = U D U^T, adds rank( K ) states w = D U^T x / ( E - P ):
+        //      [ M0      U   ] [ x ]     [ x ]
+        //      [ D U^T   P   ] [ w ] = E [ w ]
+        // M0 is the static matrix plus the constant parts of the tables.
+        // Only possible when every dynamic term is tabulated.
+        util::matrix_t build_linearized() const;
+        // An upper bound on the size of build_linearized(), without the
+        // decompositions of the residue matrices.
+        int linearized_size_bound() const;
+
+        // The energies above 0 where the tabulated terms really have a
+        // pole, up to the first one above Emax, with poles closer than
+        // tolerance merged (see pole_asymptotes).  Usually far fewer than
+        // get_erpa_asymptotes lists, since many 2p2h states do not couple
+        // to the channel.  Only possible when every dynamic term is
+        // tabulated.
+        std::vector< double > asymptotes( double Emax,
+                                          double tolerance ) const;
+
+        // A cheaper factory for energies in [ lower, upper ], between two
+        // asymptotes.  The poles within a quarter of the width of the
+        // interval are kept; the rest are replaced by a Chebyshev fit of
+        // the given degree (see ChebyshevTable.h).  It has a cache of its
+        // own.  Only possible when every dynamic term is tabulated.
+        MatrixFactory surrogate( double lower, double upper,
+                                 int degree ) const;
+        bool is_surrogate() const { return 0 != A_fit.get(); }
+
+        // True when S build( E ) is symmetric at every E, so that the
+        // eigenvalues can be counted by inertia (util::rpa_count_values).
+        // The static matrix decides:  the dynamic terms only add to A and
+        // A*, and symmetrically.  In ERPA, B* is usually not B^T.
+        bool has_rpa_structure() const { return rpa_structure; }
     private:
-        const util::matrix_t                   static_matrix;
-        const std::vector< Term >              dynamic_terms;
-        const std::vector< ParticleHoleState > ph_states;
-        const SingleParticleModelspace         spms;
+        void check() const;
+
+        typedef std::vector< ParticleHoleState > ph_states_t;
+
+        boost::shared_ptr< const util::matrix_t > static_matrix;
+        std::vector< Term >                       dynamic_terms;
+        // A_star_poles holds -A*, matching the sign used in build
+        boost::shared_ptr< const PoleTable >      A_poles;
+        boost::shared_ptr< const PoleTable >      A_star_poles;
+        // Only in a surrogate:  the fits of the poles left out of the tables
+        boost::shared_ptr< const ChebyshevTable > A_fit;
+        boost::shared_ptr< const ChebyshevTable > A_star_fit;
+        boost::shared_ptr< const ph_states_t >    ph_states;
+        boost::shared_ptr< EigenvalueCache >      eigenvalues;
+        bool rpa_structure;
         int J, parity, tz;
 };
 
@@ -1,5 +1,6 @@
 #include <cassert>
 #include <iostream>
+#include <algorithm>
 #include <set>
 #include <boost/numeric/conversion/cast.hpp>
 #include <boost/foreach.hpp>
@@ -99,6 +100,26 @@ std::vector< double > get_erpa_asymptotes( int tz, int parity, int J,
                                          - hh_energy(hh, spms) ); } } } } } }
     return std::vector< double >( result.begin(), result.end() ); }
 
+int count_2p2h_states( int tz, int parity, int J,
+                       const StateChannels &ppc, const StateChannels &hhc ) {
+    int result = 0;
+    for ( int pptz = -1; pptz <= 1; ++pptz ) {
+        int hhtz = pptz - tz;
+        if ( hhtz < -1 || hhtz > 1 )
+            continue;
+        for ( int ppparity = -1; ppparity <= 1; ppparity += 2 ) {
+            int hhparity = parity * ppparity;
+            for ( int ppJ = 0; ppJ < ppc.num_J( pptz, ppparity ); ++ppJ ) {
+                int num_pp = ppc.end( pptz, ppparity, ppJ )
+                           - ppc.begin( pptz, ppparity, ppJ );
+                int hhJmax = std::min( ppJ + J,
+                                       hhc.num_J( hhtz, hhparity ) - 1 );
+                for ( int hhJ = std::abs( ppJ - J ); hhJ <= hhJmax; ++hhJ ) {
+                    result += num_pp * ( hhc.end( hhtz, hhparity, hhJ )
+                                       - hhc.begin( hhtz, hhparity, hhJ ) );
+                    } } } }
+    return result; }
+
 void print_ph_modelspace_sizes( std::ostream &o,
                                 const ParticleHoleModelspace &phms ) {
     o << " tz  J^parity  size " << std::endl;
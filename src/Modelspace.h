@@ -127,6 +127,41 @@ struct SEModelspace {
     PPFromSP hp;
 };
 
+// Flat copy of a ph, pp or hh modelspace for the inner loops of the dynamic
+// terms.  All channels share one set of arrays; the states of channel
+// ( tz, parity, J ) are [ begin( tz, parity, J ), end( tz, parity, J ) ).
+// Each state carries its shells and the energy and strength of its
+// fragments, so a loop over a channel reads straight through memory.
+//  ph states:  i1 = ip,  i2 = ih,  E = E_p - E_h,    S = S_p * S_h
+//  pp states:  i1 = ip1, i2 = ip2, E = E_p1 + E_p2,  S = S_p1 * S_p2
+//  hh states:  i1 = ih1, i2 = ih2, E = E_h1 + E_h2,  S = S_h1 * S_h2
+//
+//  StateChannels ph = build_ph_channels( phms, spms );
+//  for ( int n = ph.begin( tz, parity, J ); n < ph.end( tz, parity, J ); ++n )
+//      add_pole( s, ph.S[n] * G( ph.i1[n], ph.i2[n] ), ph.E[n] );
+struct StateChannels {
+    // Number of J values of channel ( tz, parity ).
+    int num_J( int tz, int parity ) const {
+        int b = block( tz, parity );
+        return first_J[ b + 1 ] - first_J[ b ]; }
+    int begin( int tz, int parity, int J ) const {
+        return offsets[ first_J[ block( tz, parity ) ] + J ]; }
+    int end( int tz, int parity, int J ) const {
+        return offsets[ first_J[ block( tz, parity ) ] + J + 1 ]; }
+
+    // Channel ( tz, parity, J ) is number first_J[ block ] + J.
+    std::vector< int >    first_J;
+    // The states of channel c are [ offsets[c], offsets[c+1] ).
+    std::vector< int >    offsets;
+    std::vector< int >    i1;
+    std::vector< int >    i2;
+    std::vector< double > E;
+    std::vector< double > S;
+
+    static int block( int tz, int parity ) {
+        return 2 * ( tz + 1 ) + ( parity + 1 ) / 2; }
+};
+
 // Some SP Modelspace functions
 int get_max_pp_J(   const SingleParticleModelspace &spms, int tz, int parity );
 int get_max_ph_J(   const SingleParticleModelspace &spms, int tz, int parity );
@@ -145,6 +180,12 @@ std::vector< double > get_erpa_asymptotes( int tz, int parity, int J,
                                 const ParticleParticleModelspace &ppms,
                                 const ParticleParticleModelspace &hhms,
                                 const SingleParticleModelspace &spms );
+
+// The number of 2p2h states ( pp, hh ) of channel ( tz, parity, J ):  the
+// pp and hh channels whose J can couple to J, counted from the channel
+// sizes alone.  An upper bound on the number of asymptotes.
+int count_2p2h_states( int tz, int parity, int J,
+                       const StateChannels &ppc, const StateChannels &hhc );
 // IO Functions
 void print_ph_modelspace_sizes( std::ostream &o,
                                 const ParticleHoleModelspace &phms );
@@ -0,0 +1,181 @@
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+
+#include <boost/foreach.hpp>
+
+#include "PoleTable.h"
+
+// --------------------------------------------------------------------
+// PoleSum helpers
+// --------------------------------------------------------------------
+void add_pole( PoleSum &s, double R, double E ) {
+    s.poles.push_back( Pole( R, E ) ); }
+
+void add( PoleSum &s, const PoleSum &other, double scale ) {
+    s.constant += scale * other.constant;
+    BOOST_FOREACH( const Pole &p, other.poles ) {
+        s.poles.push_back( Pole( scale * p.R, p.E ) ); } }
+
+double evaluate( const PoleSum &s, double E ) {
+    double result = s.constant;
+    BOOST_FOREACH( const Pole &p, s.poles ) {
+        result += p.R / ( E - p.E ); }
+    return result; }
+
+double evaluate_derivative( const PoleSum &s, double E ) {
+    double result = 0;
+    BOOST_FOREACH( const Pole &p, s.poles ) {
+        double d = E - p.E;
+        result -= p.R / ( d * d ); }
+    return result; }
+
+// R / ( -E - P ) = -R / ( E + P )
+PoleSum reflect( const PoleSum &s ) {
+    PoleSum result;
+    result.constant = s.constant;
+    result.poles.reserve( s.poles.size() );
+    BOOST_FOREACH( const Pole &p, s.poles ) {
+        result.poles.push_back( Pole( -p.R, -p.E ) ); }
+    return result; }
+
+PoleSum shift( const PoleSum &s, double dE ) {
+    PoleSum result;
+    result.constant = s.constant;
+    result.poles.reserve( s.poles.size() );
+    BOOST_FOREACH( const Pole &p, s.poles ) {
+        result.poles.push_back( Pole( p.R, p.E + dE ) ); }
+    return result; }
+
+void compress( PoleSum &s ) {
+    std::sort( s.poles.begin(), s.poles.end() );
+    std::vector< Pole > merged;
+    BOOST_FOREACH( const Pole &p, s.poles ) {
+        if ( !merged.empty() && merged.back().E == p.E )
+            merged.back().R += p.R;
+        else
+            merged.push_back( p ); }
+
+    s.poles.clear();
+    BOOST_FOREACH( const Pole &p, merged ) {
+        if ( 0 != p.R )
+            s.poles.push_back( p ); } }
+
+std::vector< double > pole_asymptotes( std::vector< Pole > poles,
+                                       double Emin, double Emax,
+                                       double tolerance ) {
+    double largest = 0;
+    BOOST_FOREACH( const Pole &p, poles ) {
+        largest = std::max( largest, std::abs( p.R ) ); }
+    std::sort( poles.begin(), poles.end() );
+
+    std::vector< double > result;
+    BOOST_FOREACH( const Pole &p, poles ) {
+        if ( p.E <= Emin || std::abs( p.R ) <= 1e-12 * largest )
+            continue;
+        if ( !result.empty() && p.E - result.back() <= tolerance )
+            continue;
+        if ( !result.empty() && result.back() > Emax )
+            break;
+        result.push_back( p.E ); }
+    return result; }
+
+// --------------------------------------------------------------------
+// PoleTable
+// --------------------------------------------------------------------
+int PoleTable::index( int i, int k ) const {
+    assert( 0 <= i && i < size );
+    assert( 0 <= k && k < size );
+    if ( i > k )
+        std::swap( i, k );
+    // Row i of the upper triangle starts after i rows of decreasing length
+    return i * size - i * ( i - 1 ) / 2 + ( k - i ); }
+
+PoleSum &PoleTable::operator()( int i, int k ) {
+    packed = false;
+    return elements[ index( i, k ) ]; }
+
+const PoleSum &PoleTable::operator()( int i, int k ) const {
+    return elements[ index( i, k ) ]; }
+
+void PoleTable::add( const PoleTable &other ) {
+    assert( size == other.size );
+    packed = false;
+    for ( int e = 0; e < static_cast<int>(elements.size()); ++e ) {
+        ::add( elements[e], other.elements[e] ); } }
+
+void PoleTable::compress() {
+    BOOST_FOREACH( PoleSum &s, elements ) {
+        ::compress( s ); }
+    pack(); }
+
+void PoleTable::split( double lower, double upper,
+                       PoleTable &inside, PoleTable &outside ) const {
+    inside  = PoleTable( size );
+    outside = PoleTable( size );
+    for ( int e = 0; e < static_cast<int>(elements.size()); ++e ) {
+        inside.elements[e].constant = elements[e].constant;
+        BOOST_FOREACH( const Pole &p, elements[e].poles ) {
+            PoleTable &part = lower <= p.E && p.E <= upper ? inside : outside;
+            part.elements[e].poles.push_back( p ); } }
+    inside.compress();
+    outside.compress(); }
+
+void PoleTable::pack() {
+    offsets.assign( 1, 0 );
+    residues.clear();
+    energies.clear();
+    residues.reserve( num_poles() );
+    energies.reserve( num_poles() );
+    BOOST_FOREACH( const PoleSum &s, elements ) {
+        BOOST_FOREACH( const Pole &p, s.poles ) {
+            residues.push_back( p.R );
+            energies.push_back( p.E ); }
+        offsets.push_back( residues.size() ); }
+    packed = true; }
+
+double PoleTable::value( int n, double E ) const {
+    if ( !packed )
+        return ::evaluate( elements[n], E );
+    int first = offsets[n];
+    int count = offsets[n+1] - first;
+    if ( 0 == count )
+        return elements[n].constant;
+    return elements[n].constant
+        + rational_sum( &residues[first], &energies[first], count, E ); }
+
+void PoleTable::value( int n, const std::vector< double > &E,
+                       std::vector< double > &result ) const {
+    int nE = E.size();
+    result.resize( nE );
+    if ( !packed ) {
+        for ( int e = 0; e < nE; ++e ) {
+            result[e] = ::evaluate( elements[n], E[e] ); }
+        return; }
+    result.assign( nE, elements[n].constant );
+    int first = offsets[n];
+    int count = offsets[n+1] - first;
+    if ( count > 0 && nE > 0 )
+        rational_sums( &residues[first], &energies[first], count,
+                       &E[0], nE, &result[0] ); }
+
+double PoleTable::derivative( int n, double E ) const {
+    if ( !packed )
+        return ::evaluate_derivative( elements[n], E );
+    int first = offsets[n];
+    int count = offsets[n+1] - first;
+    if ( 0 == count )
+        return 0;
+    return rational_sum_derivative( &residues[first], &energies[first],
+                                    count, E ); }
+
+int PoleTable::num_poles() const {
+    int result = 0;
+    BOOST_FOREACH( const PoleSum &s, elements ) {
+        result += s.poles.size(); }
+    return result; }
+
+void PoleTable::collect_poles( std::vector< Pole > &result ) const {
+    result.reserve( result.size() + num_poles() );
+    BOOST_FOREACH( const PoleSum &s, elements ) {
+        result.insert( result.end(), s.poles.begin(), s.poles.end() ); } }
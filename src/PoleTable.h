@@ -0,0 +1,164 @@
+#ifndef _POLE_TABLE_H_
+#define _POLE_TABLE_H_
+/* Energy independent representation of the dynamic ERPA terms.
+ *
+ * Every dynamic matrix element is a rational function of the energy:
+ *      m( i, k )( E ) = constant + sum_n R_n / ( E - E_n )
+ * The residues R_n and the pole positions E_n do not depend on E, so they
+ * can be tabulated once per channel.  Evaluating the matrix at a new energy
+ * is then only a short sum instead of a full second order calculation.
+ *
+ * Examples:
+ *  PoleSum s;
+ *  s.constant = 1;
+ *  add_pole( s, 0.5, 3.0 );        // s( E ) = 1 + 0.5 / ( E - 3 )
+ *  double value = evaluate( s, E );
+ *
+ *  PoleTable table( size );        // symmetric, size x size
+ *  add( table( i, k ), s );
+ *  table.evaluate( E, m );         // m += table( E )
+ *  table.evaluate_derivative( E, m );  // m += d table / d E
+ *  table.evaluate( energies, ms ); // ms[e] += table( energies[e] )
+ *
+ * PoleTable::compress() also packs the poles of the whole table into flat
+ * arrays of residues and pole energies, which the evaluation then sums with
+ * the vector kernels of rational_sum.h.  Changing an element afterwards
+ * drops the packed copy until the next compress().
+ */
+
+#include <cassert>
+#include <vector>
+
+#include "linalg.h"
+#include "rational_sum.h"
+
+// Constant public data members allow for a simple interface.
+struct Pole {
+    Pole( double nR, double nE )
+        : R( nR ), E( nE ) { }
+    double R;
+    double E;
+    bool operator<( const Pole &sister ) const {
+        return E < sister.E; }
+};
+
+struct PoleSum {
+    PoleSum() : constant( 0 ) { }
+    double              constant;
+    std::vector< Pole > poles;
+};
+
+void   add_pole( PoleSum &s, double R, double E );
+void   add( PoleSum &s, const PoleSum &other, double scale = 1 );
+double evaluate( const PoleSum &s, double E );
+// d s / d E = - sum_n R_n / ( E - E_n )^2
+double evaluate_derivative( const PoleSum &s, double E );
+
+// Returns s( -E ), written as a sum of poles in E.
+PoleSum reflect( const PoleSum &s );
+// Returns s( E - dE ), i.e. every pole moved up by dE.
+PoleSum shift( const PoleSum &s, double dE );
+
+// Sorts the poles, combines poles at identical energies and drops poles
+// with no residue.
+void compress( PoleSum &s );
+
+// The energies of poles, lowest first, for use as the asymptotes of a root
+// search.  Poles whose residue is below 1e-12 of the largest are not real
+// asymptotes and are left out, and a pole within tolerance of the last
+// energy listed is merged into it.  Only energies above Emin are listed, up
+// to and including the first one above Emax.
+std::vector< double > pole_asymptotes( std::vector< Pole > poles,
+                                       double Emin, double Emax,
+                                       double tolerance );
+
+// Holds the upper triangle of a symmetric matrix of PoleSums.
+class PoleTable {
+    public:
+        PoleTable( int nsize = 0 )
+            : elements( nsize * ( nsize + 1 ) / 2 ), size( nsize ),
+              packed( false ) { }
+
+        // Drops the packed copy.
+        PoleSum       &operator()( int i, int k );
+        const PoleSum &operator()( int i, int k ) const;
+
+        int dimension() const { return size; }
+
+        // Adds every element of other (which must be the same size).
+        void add( const PoleTable &other );
+        // Compresses every element and packs the table.
+        void compress();
+        // Sorts the poles into those at energies in [ lower, upper ], which
+        // go into inside with the constants, and the rest, which go into
+        // outside.  Both are compressed.
+        void split( double lower, double upper,
+                    PoleTable &inside, PoleTable &outside ) const;
+
+        // Adds the value of the table at E into m.
+        template < class M >
+        void evaluate( double E, M &m ) const;
+        // Adds the derivative of the table at E into m.
+        template < class M >
+        void evaluate_derivative( double E, M &m ) const;
+        // Adds the value of the table at E[e] into m[e], for every e.  The
+        // poles of each element are summed for all energies in one pass.
+        template < class M >
+        void evaluate( const std::vector< double > &E,
+                       std::vector< M > &m ) const;
+
+        int num_poles() const;
+        // Appends the poles of every element to result.
+        void collect_poles( std::vector< Pole > &result ) const;
+    private:
+        int index( int i, int k ) const;
+        void pack();
+        double value( int n, double E ) const;
+        double derivative( int n, double E ) const;
+        // result[e] = value( n, E[e] )
+        void   value( int n, const std::vector< double > &E,
+                      std::vector< double > &result ) const;
+
+        std::vector< PoleSum > elements;
+        int                    size;
+
+        // The packed copy:  the poles of element n are
+        // [ offsets[n], offsets[n+1] ) of residues and energies.
+        bool                   packed;
+        std::vector< int >     offsets;
+        std::vector< double >  residues;
+        std::vector< double >  energies;
+};
+
+template < class M >
+void PoleTable::evaluate( double E, M &m ) const {
+    for ( int i = 0; i < size; ++i ) {
+        for ( int k = i; k < size; ++k ) {
+            double value = this->value( index( i, k ), E );
+            m( i, k ) += value;
+            if ( i != k )
+                m( k, i ) += value; } } }
+
+template < class M >
+void PoleTable::evaluate_derivative( double E, M &m ) const {
+    for ( int i = 0; i < size; ++i ) {
+        for ( int k = i; k < size; ++k ) {
+            double value = derivative( index( i, k ), E );
+            m( i, k ) += value;
+            if ( i != k )
+                m( k, i ) += value; } } }
+
+template < class M >
+void PoleTable::evaluate( const std::vector< double > &E,
+                          std::vector< M > &m ) const {
+    assert( E.size() == m.size() );
+    std::vector< double > values( E.size() );
+    for ( int i = 0; i < size; ++i ) {
+        for ( int k = i; k < size; ++k ) {
+            value( index( i, k ), E, values );
+            for ( unsigned int e = 0; e < E.size(); ++e ) {
+                m[e]( i, k ) += values[e];
+                if ( i != k )
+                    m[e]( k, i ) += values[e]; } } } }
+
+#endif // _POLE_TABLE_H_
@@ -2,14 +2,47 @@
 #define _DYANMIC_TERM_H_
 
 #include <boost/function.hpp>
+#include <boost/numeric/ublas/matrix_proxy.hpp>
 
 #include "linalg.h"
 #include "Modelspace.h"
+#include "PoleTable.h"
 
 enum position_t { ENUM_A, ENUM_A_STAR, ENUM_B, ENUM_B_STAR };
 
+// Where a term adds its elements:  the size x size block of the full
+// matrix for position pos, and the factor the elements enter it with.
+// MatrixFactory passes a scale of -1 for A* and B*, which enter the full
+// matrix with a minus sign.
+struct TermBlock {
+    typedef boost::numeric::ublas::matrix_range< util::matrix_t > block_t;
+    TermBlock( position_t npos, const block_t &nm, double nscale = 1 )
+        : pos( npos ), m( nm ), scale( nscale ) { }
+
+    // Adds scale * value at ( i, k ) and, off the diagonal, at ( k, i ).
+    void add( int i, int k, double value ) {
+        m( i, k ) += scale * value;
+        if ( i != k )
+            m( k, i ) += scale * value; }
+
+    position_t pos;
+    block_t    m;
+    double     scale;
+};
+
+// Adds the term at energy E into the block, where the basis is the ph
+// states of one channel.
 typedef boost::function<
-    util::matrix_t( const std::vector< ParticleHoleState >, double, position_t )
+    void( const std::vector< ParticleHoleState > &, double, TermBlock & )
 > Term;
 
+// Energy independent form of a dynamic term (see PoleTable.h).  Only the
+// energy dependent blocks can be tabulated; both are filled in one sweep
+// over the basis, adding the term to A and subtracting it from A_star, the
+// signs with which they enter the full matrix.
+typedef boost::function<
+    void( const std::vector< ParticleHoleState > &, PoleTable &A,
+          PoleTable &A_star )
+> PoleTerm;
+
 #endif // _DYANMIC_TERM_H_
@@ -5,22 +5,28 @@
 
 #include <vector>
 #include <cmath>
+#include <cstdlib>
+#include <limits>
 
 #include "exceptions.h"
 //#include "state.h"
 
 #include "angular_momentum.h"
 
-// NOTE this factorial is not threadsafe.
-static std::vector< double > factorial_array(2,1); //[1, 1]);
+// Every factorial that fits in a double, filled in before main so that
+// factorial is thread safe.
+static std::vector< double > make_factorial_array() {
+    std::vector< double > result( 1, 1 );
+    while ( result.size() <= 170 ) {
+        result.push_back( result.size() * result.back() ); }
+    return result;
+}
+
+static const std::vector< double > factorial_array = make_factorial_array();
 double factorial(int n)
 {
-    for (int i = factorial_array.size(); i <= n; ++i) {
-        size_t size = factorial_array.size();
-        factorial_array.push_back( size *
-                factorial_array[ size - 1 ] );
-    }
-
+    if ( n >= static_cast<int>(factorial_array.size()) )
+        return std::numeric_limits< double >::infinity();
     return factorial_array[n];
 }
 
@@ -179,3 +185,60 @@ wigner6j(double j1, double j2, double j3, double J1, double J2, double J3) {
                                triangle_coef(J1, J2, j3) );
     return factor * sum;
 }
+
+// --------------------------------------------------------------------
+// Wigner 6j table
+// --------------------------------------------------------------------
+// Layout: a block [j3 offset][J3 offset] for every [2 j1][2 j2][2 J1][2 J2],
+// where the offsets count up from the smallest j3 (J3) triangular with j1,
+// j2 (j1, J2).  There are min( 2 j1, 2 j2 ) + 1 (min( 2 j1, 2 J2 ) + 1) of
+// those.  Only blocks with j1 + j2 + J1 + J2 an integer can hold a nonzero
+// symbol, and only those are stored.
+Wigner6jTable::Wigner6jTable( double maxj )
+    : size( maxj < 0 ? 0 : static_cast<int>( 2 * maxj ) + 1 ),
+      offsets( size * size * size * size, -1 ) {
+    int block = 0;
+    for ( int a = 0; a < size; ++a ) {
+    for ( int b = 0; b < size; ++b ) {
+    for ( int A = 0; A < size; ++A ) {
+    for ( int B = 0; B < size; ++B, ++block ) {
+        if ( ( a + b + A + B ) % 2 )
+            continue;
+        offsets[ block ] = values.size();
+        for ( int o3 = 0; o3 <= std::min( a, b ); ++o3 ) {
+            for ( int o6 = 0; o6 <= std::min( a, B ); ++o6 ) {
+                double j3 = ( std::abs( a - b ) + 2*o3 ) / 2.0;
+                double J3 = ( std::abs( a - B ) + 2*o6 ) / 2.0;
+                values.push_back( wigner6j( a / 2.0, b / 2.0, j3,
+                                            A / 2.0, B / 2.0, J3 ) );
+            } } } } } }
+}
+
+double Wigner6jTable::operator()( double j1, double j2, double j3,
+                                  double J1, double J2, double J3 ) const {
+    int a  = static_cast<int>( 2 * j1 );
+    int b  = static_cast<int>( 2 * j2 );
+    int A  = static_cast<int>( 2 * J1 );
+    int B  = static_cast<int>( 2 * J2 );
+    int c  = static_cast<int>( 2 * j3 );
+    int C  = static_cast<int>( 2 * J3 );
+    int o3 = c - std::abs( a - b );
+    int o6 = C - std::abs( a - B );
+
+    bool in_table = a < size && b < size && A < size && B < size
+                 && a >= 0   && b >= 0   && A >= 0   && B >= 0
+                 && a == 2 * j1 && b == 2 * j2 && c == 2 * j3
+                 && A == 2 * J1 && B == 2 * J2 && C == 2 * J3;
+    if ( !in_table )
+        return wigner6j( j1, j2, j3, J1, J2, J3 );
+
+    // Not triangular with j1, j2 or j1, J2
+    if ( o3 < 0 || o3 % 2 || o3 > 2 * std::min( a, b ) ||
+         o6 < 0 || o6 % 2 || o6 > 2 * std::min( a, B ) )
+        return 0;
+
+    int offset = offsets[ ( ( a * size + b ) * size + A ) * size + B ];
+    if ( offset < 0 )
+        return 0;
+    return values[ offset + o3 / 2 * ( std::min( a, B ) + 1 ) + o6 / 2 ];
+}
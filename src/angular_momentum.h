@@ -7,6 +7,8 @@
 #ifndef _NUCLEAR_ANGULAR_MOMENTUM_H_
 #define _NUCLEAR_ANGULAR_MOMENTUM_H_
 
+#include <vector>
+
 double factorial(int n);
 
 bool is_integer            (double j);
@@ -22,4 +24,21 @@ double clebsch_gordan(double j1, double m1, double j2, double m2,
 double wigner6j(double j1, double j2, double j3,
                 double J1, double J2, double J3);
 
+// Precomputed Wigner 6j symbols { j1, j2, j3; J1, J2, J3 } for
+// j1, j2, J1, J2 <= maxj (usually spms.maxj), indexed by the doubled
+// arguments.  The table is read-only once built, so lookups are thread
+// safe.  Symbols outside the table are calculated with wigner6j.  Build
+// one table per program and share it.
+class Wigner6jTable {
+    public:
+        explicit Wigner6jTable( double maxj = -1 );
+        double operator()( double j1, double j2, double j3,
+                           double J1, double J2, double J3 ) const;
+    private:
+        int                   size;
+        // Where each block of values starts, -1 for blocks not stored
+        std::vector< int >    offsets;
+        std::vector< double > values;
+};
+
 #endif // _NUCLEAR_ANGULAR_MOMENTUM_H_
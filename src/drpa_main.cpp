@@ -4,6 +4,7 @@
 
 #include <boost/foreach.hpp>
 #include <boost/numeric/ublas/io.hpp>
+#include <boost/thread/thread.hpp>
 
 #include <boost/program_options/variables_map.hpp>
 #include <boost/program_options/options_description.hpp>
@@ -50,7 +51,10 @@ int main( int argc, char *argv[] ) {
     config_desc.add_options()
         ("interaction_file", po::value<std::string>(), "Interaction filename.")
         ("modelspace_file",  po::value<std::string>(), "Modelspace filename.")
-        ("output_file",      po::value<std::string>(), "Full output filename.");
+        ("output_file",      po::value<std::string>(), "Full output filename.")
+        ("gmatrix_cache",    po::value<bool>()->default_value( false ),
+                             "Keep a binary copy of the interaction file "
+                             "next to it, read instead on later runs.");
     po::variables_map config_vm;
     {   std::ifstream cfile(cmdline_vm["config"].as<std::string>().c_str());
         po::store( po::parse_config_file( cfile,
@@ -82,8 +86,11 @@ int main( int argc, char *argv[] ) {
     // Particle-hole interaction
     std::cout << "Building interaction objects." << std::endl;
     PPInteraction Gpp = build_gmatrix_from_mhj_file(
-            config_vm["interaction_file"].as<std::string>(), spms );
-    PHInteraction Gph = build_ph_interaction_from_pp( Gpp, spms );
+            config_vm["interaction_file"].as<std::string>(), spms,
+            config_vm["gmatrix_cache"].as<bool>() );
+    Wigner6jTable sixj( spms.maxj );
+    PHInteraction Gph = build_ph_interaction_from_pp( Gpp, spms, sixj,
+            boost::thread::hardware_concurrency() );
     std::cout << "Finished building interactions." << std::endl;
 
     // Build terms
@@ -98,7 +105,7 @@ int main( int argc, char *argv[] ) {
                 phms[tz + 1][(parity+1)/2][J] ) );
     std::cout << "Performing eigenvalue calculation." << std::endl;
 
-    util::cvector_t vals = util::eigenvalues( rpa_matrix );
+    util::cvector_t vals = util::rpa_eigenvalues( rpa_matrix );
     std::cout << "Calculation complete." << std::endl;
 
     std::ofstream outfile(
@@ -1,10 +1,14 @@
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <string>
 
 #include <boost/foreach.hpp>
 #include <boost/numeric/ublas/io.hpp>
 #include <boost/numeric/conversion/cast.hpp>
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
 
 #include <boost/program_options/variables_map.hpp>
 #include <boost/program_options/options_description.hpp>
@@ -22,9 +26,76 @@
 #include "pp_interaction_factories.h"
 #include "term_factories.h"
 #include "search.h"
+#include "scheduler.h"
 
 namespace po = boost::program_options;
 
+// Solutions are searched for up to Emax, no closer than epsilon to an
+// asymptote.
+const double Emax    = 10;
+const double epsilon = 0.0001;
+
+// Constant public data members allow for a simple interface.
+struct Channel {
+    Channel( int nJ, int nparity, int ntz )
+        : J( nJ ), parity( nparity ), tz( ntz ) { }
+    int J, parity, tz;
+};
+
+std::vector< double >
+solve_channel( int index,
+               const std::vector< Channel > &channels,
+               const std::vector< Term > &static_terms,
+               const std::vector< Term > &B_terms,
+               const std::vector< PoleTerm > &pole_terms,
+               const ParticleHoleModelspace &phms,
+               int linearized_max_size, int search_threads,
+               int surrogate_degree ) {
+    const Channel &c = channels[index];
+    const std::vector< ParticleHoleState > &ph_states =
+                phms[c.tz + 1][(c.parity+1)/2][c.J];
+    MatrixFactory mf(
+            build_static_erpa_matrix( static_terms, B_terms, ph_states ),
+            pole_terms, ph_states, c.J, c.parity, c.tz );
+    // Only the poles the channel really has bound the search regions.
+    std::vector< double > asymptotes = mf.asymptotes( Emax, epsilon );
+    // Channels whose linearized problem has at most linearized_max_size
+    // states are solved that way, the rest are searched.
+    if ( linearized_max_size > 0 ) {
+        int size = mf.linearized_size_bound();
+        if ( size <= linearized_max_size )
+            return solve_linearized_eigenvalues( Emax, mf, asymptotes,
+                                                 epsilon );
+        std::ostringstream report;
+        report << "Linearized problem for tz = " << c.tz << ", J = " << c.J
+            << ", parity = " << c.parity << " has up to " << size
+            << " states; searching instead.\n";
+        std::cerr << report.str() << std::flush; }
+    std::vector< double > vals = solve_derpa_eigenvalues( Emax, mf,
+            asymptotes, epsilon, search_threads, surrogate_degree );
+
+    // Written as one piece, as other channels print from their threads.
+    const EigenvalueCache &cache = mf.eigenvalue_cache();
+    std::ostringstream report;
+    report << "Eigenvalue cache for tz = " << c.tz << ", J = " << c.J
+        << ", parity = " << c.parity << ": " << cache.hits() << " hits, "
+        << cache.misses() << " misses (" << 100 * cache.hit_rate()
+        << "%).\n";
+    std::cout << report.str() << std::flush;
+    return vals; }
+
+void write_channel( std::ostream &outfile,
+                    const std::vector< Channel > &channels,
+                    int index, const std::vector< double > &vals ) {
+    const Channel &c = channels[index];
+    std::cout << "Calculation complete for tz = " << c.tz
+        << ", J = " << c.J << ", parity = " << c.parity << "." << std::endl;
+
+    outfile << "(" << c.J << ", " << c.parity << ", " << c.tz << ")\n";
+    BOOST_FOREACH( double v, vals ) {
+        outfile << v << " "; }
+    outfile << "\n" << std::endl; }
+
 int main( int argc, char *argv[] ) {
 
     // Options parsed by the command line
@@ -52,7 +123,27 @@ int main( int argc, char *argv[] ) {
     config_desc.add_options()
         ("interaction_file", po::value<std::string>(), "Interaction filename.")
         ("modelspace_file",  po::value<std::string>(), "Modelspace filename.")
-        ("output_file",      po::value<std::string>(), "Full output filename.");
+        ("output_file",      po::value<std::string>(), "Full output filename.")
+        ("gmatrix_cache",    po::value<bool>()->default_value( false ),
+                             "Keep a binary copy of the interaction file "
+                             "next to it, read instead on later runs.")
+        ("num_threads",      po::value<int>()->default_value(
+                    boost::thread::hardware_concurrency() ),
+                             "Number of channels solved at once.")
+        ("search_threads",   po::value<int>()->default_value( 1 ),
+                             "Number of threads searching each channel.")
+        ("surrogate_degree", po::value<int>()->default_value( 0 ),
+                             "Degree of the Chebyshev fits the search uses "
+                             "between asymptotes, 0 to search the exact "
+                             "problem.")
+        ("solver",           po::value<std::string>()->default_value(
+                    "search" ),
+                             "'search' between asymptotes, or one dense "
+                             "solve of the 'linearized' problem, to check "
+                             "the search on small channels.")
+        ("linearized_max_size", po::value<int>()->default_value( 2000 ),
+                             "Largest linearized problem solved; larger "
+                             "channels are searched instead.");
     po::variables_map config_vm;
     {   std::ifstream cfile(cmdline_vm["config"].as<std::string>().c_str());
         po::store( po::parse_config_file( cfile,
@@ -69,6 +160,10 @@ int main( int argc, char *argv[] ) {
     if ( !config_vm.count("output_file") ) {
         std::cerr << "Output file not specified in config file.\n";
         return 1; }
+    std::string solver = config_vm["solver"].as<std::string>();
+    if ( "search" != solver && "linearized" != solver ) {
+        std::cerr << "Unknown solver '" << solver << "' in config file.\n";
+        return 1; }
 
     // Instantiate the object graph for the calculation.
     // Modelspaces
@@ -84,50 +179,66 @@ int main( int argc, char *argv[] ) {
     std::cout << "Modelspaces built." << std::endl;
     print_ph_modelspace_sizes( std::cout, 0, phms );
 
+    // One table of 6j symbols for the Pandya transformation and every term
+    boost::shared_ptr< const Wigner6jTable > sixj(
+            new Wigner6jTable( spms.maxj ) );
+    // The states of every channel, shared by every term
+    boost::shared_ptr< const StateChannels > phc(
+            new StateChannels( build_ph_channels( phms, spms ) ) );
+    boost::shared_ptr< const StateChannels > ppc(
+            new StateChannels( build_pp_channels( ppms, spms ) ) );
+    boost::shared_ptr< const StateChannels > hhc(
+            new StateChannels( build_hh_channels( hhms, spms ) ) );
+
     // Setup particle-particle and particle-hole interactions
     std::cout << "Building interaction objects." << std::endl;
     PPInteraction Gpp = build_gmatrix_from_mhj_file(
-            config_vm["interaction_file"].as<std::string>(), spms );
-    PHInteraction Gph = build_ph_interaction_from_pp( Gpp, spms );
+            config_vm["interaction_file"].as<std::string>(), spms,
+            config_vm["gmatrix_cache"].as<bool>() );
+    PHInteraction Gph = build_ph_interaction_from_pp( Gpp, spms, *sixj,
+            config_vm["num_threads"].as<int>() );
     std::cout << "Finished building interactions." << std::endl;
 
     // Build terms
     std::vector< Term > static_terms
         = build_rpa_terms( Gph, spms );
-    std::vector< Term > dynamic_terms
-        = build_dynamic_erpa_terms( Gph, Gpp, phms, ppms, hhms, sems, spms );
+    std::vector< Term > B_terms;
+    std::vector< PoleTerm > pole_terms
+        = build_dynamic_erpa_pole_terms( Gph, Gpp, phc, ppc, hhc, sems,
+                                         spms, sixj, B_terms );
 
     int tz     =  0;
 
-    std::ofstream outfile(
-            config_vm["output_file"].as<std::string>().c_str() );
+    // Every (J, parity) channel is independent.  The largest ones are
+    // started first so that they do not finish last on their own.
+    std::vector< Channel > channels;
+    std::vector< double >  costs;
     for ( int parity = -1; parity <= 1; parity += 2 ) {
         for ( int J = 0;
                 J <= boost::numeric_cast<int>(get_max_ph_J( spms, tz, parity ));
                 ++J ) {
-            // Matrix Factory
-            const std::vector< ParticleHoleState > &ph_states =
-                        phms[tz + 1][(parity+1)/2][J];
-            std::cout << "Building static part of matrix for tz = " << tz
-                << ", J = " << J << ", parity = " << parity
-                << " with " << ph_states.size() << " states." << std::endl;
-            MatrixFactory mf(
-                    build_static_erpa_matrix( static_terms, dynamic_terms,
-                        ph_states ),
-                    dynamic_terms, spms, ph_states, J, parity, tz );
-            std::cout << "Performing self-consistent eigenvalue calculation."
-                << std::endl;
-            // Asymptotes
-            std::vector< double > asymptotes
-                = get_erpa_asymptotes( tz, parity, J, ppms, hhms, spms );
-
-            std::vector< double > vals
-                = solve_derpa_eigenvalues( 10, mf, asymptotes );
-
-            std::cout << "Calculation complete." << std::endl;
-
-            outfile << "(" << J << ", " << parity << ", " << tz << ")\n";
-            BOOST_FOREACH( double v, vals ) { 
-                outfile << v << " "; }
-            outfile << "\n" << std::endl; } }
+            channels.push_back( Channel( J, parity, tz ) );
+            costs.push_back( estimate_channel_cost(
+                        phms[tz + 1][(parity+1)/2][J].size(),
+                        count_2p2h_states( tz, parity, J, *ppc, *hhc ) ) ); } }
+
+    int num_threads = config_vm["num_threads"].as<int>();
+    std::cout << "Solving " << channels.size() << " channels using "
+        << num_threads << " threads." << std::endl;
+
+    std::ofstream outfile(
+            config_vm["output_file"].as<std::string>().c_str() );
+    run_channels( costs,
+                  boost::bind( solve_channel, _1,
+                      boost::cref( channels ),
+                      boost::cref( static_terms ), boost::cref( B_terms ),
+                      boost::cref( pole_terms ),
+                      boost::cref( phms ),
+                      "linearized" == solver
+                        ? config_vm["linearized_max_size"].as<int>() : 0,
+                      config_vm["search_threads"].as<int>(),
+                      config_vm["surrogate_degree"].as<int>() ),
+                  boost::bind( write_channel, boost::ref( outfile ),
+                      boost::cref( channels ), _1, _2 ),
+                  num_threads );
     return 0; }
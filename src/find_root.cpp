@@ -1,6 +1,8 @@
 //#include <iostream>
 #include <cmath>
+#include <algorithm>
 #include <boost/function.hpp>
+#include <boost/math/special_functions/fpclassify.hpp>
 
 #include "exceptions.h"
 #include "find_root.h"
@@ -93,4 +95,52 @@ double false_position( const boost::function< double (double) > &f,
     return c;
 }
 
+// Safeguarded Newton, starting from the false position estimate.
+double safe_newton(
+        const boost::function< boost::tuple< double, double > (double) > &fdf,
+        double left_limit, double right_limit,
+        double fa, double fb,
+        double precision, int max_iter ) {
+    // fa and fb must have opposite signs to ensure a solution.
+    if ( fa * fb > precision ) {
+        throw root_finding_error();
+    }
+
+    // Orient the bracket so that f( negative ) <= 0 <= f( positive ).
+    double negative = left_limit;
+    double positive = right_limit;
+    if ( fa > 0 )
+        std::swap( negative, positive );
+
+    double c       = ( fb * left_limit - fa * right_limit ) / ( fb - fa );
+    double step    = right_limit - left_limit;
+    double last    = step;
+
+    for (int iter = 0; iter < max_iter; ++iter) {
+        double fc, dfc;
+        boost::tie( fc, dfc ) = fdf( c );
+
+        // Same test as false_position: close to zero after a small step.
+        if ( 0 == fc ||
+             ( std::abs(fc) < precision && std::abs(step) < precision ) )
+            break;
+
+        if ( fc < 0 )
+            negative = c;
+        else
+            positive = c;
+
+        double next = c - fc / dfc;
+        bool inside = ( next - negative ) * ( next - positive ) < 0;
+        if ( !(boost::math::isfinite)( next ) || !inside ||
+             std::abs( 2 * fc ) > std::abs( last * dfc ) ) {
+            next = 0.5 * ( negative + positive ); }
+        last = step;
+        step = next - c;
+        c    = next;
+    }
+
+    return c;
+}
+
 } // end namespace util
@@ -2,6 +2,7 @@
 #define _UTIL_FIND_ROOT_H_
 
 #include <boost/function.hpp>
+#include <boost/tuple/tuple.hpp>
 
 namespace util {
 
@@ -14,6 +15,16 @@ double false_position( const boost::function< double (double) > &f,
                        double fa, double fb,
                        double precision=0.000001, int max_iter=20 );
 
+// Newton's method kept inside the bracket [ left_limit, right_limit ].
+// fdf returns ( f( x ), f'( x ) ).  Steps that leave the bracket, or do not
+// shrink fast enough, are replaced by bisection, as are steps where the
+// derivative is not finite.
+double safe_newton(
+        const boost::function< boost::tuple< double, double > (double) > &fdf,
+        double left_limit, double right_limit,
+        double fa, double fb,
+        double precision=0.000001, int max_iter=20 );
+
 } // end namespace util
 
 #endif // _UTIL_FIND_ROOT_H_
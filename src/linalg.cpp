@@ -5,15 +5,25 @@
 
 // <cassert> is required for geev.hpp, but not included in it..
 #include <cassert>
+#include <cmath>
+#include <algorithm>
+#include <limits>
 #include <iostream>
 #include <boost/foreach.hpp>
 #include <boost/numeric/conversion/cast.hpp>
+#include <boost/math/special_functions/fpclassify.hpp>
 #include <boost/numeric/ublas/matrix.hpp>
 #include <boost/numeric/ublas/matrix_proxy.hpp>
 #include <boost/numeric/ublas/vector.hpp>
 #include <boost/numeric/ublas/vector_proxy.hpp>
 #include <boost/numeric/bindings/lapack/geev.hpp>
+#include <boost/numeric/bindings/lapack/gesv.hpp>
+#include <boost/numeric/bindings/lapack/posv.hpp>
+#include <boost/numeric/bindings/lapack/syev.hpp>
+#include <boost/numeric/bindings/lapack/sysv.hpp>
 #include <boost/numeric/bindings/traits/ublas_matrix.hpp>
+#include <boost/numeric/bindings/traits/ublas_vector.hpp>
+#include <boost/numeric/bindings/traits/std_vector.hpp>
 
 #include "linalg.h"
 
@@ -27,10 +37,9 @@ namespace util {
 // Real valued solvers
 cvector_t eigenvalues( const matrix_t &mat ) {
     cvector_t vals(  mat.size1() );
-    matrix_t right_vecs( mat.size1(), mat.size2() );
     matrix_t * dummy = 0;
     matrix_t temp(mat);
-    lapack::geev( temp, vals, dummy, &right_vecs, lapack::optimal_workspace() );
+    lapack::geev( temp, vals, dummy, dummy, lapack::optimal_workspace() );
     return vals; }
 
 std::pair< cvector_t, matrix_t > eig( const matrix_t &mat ) {
@@ -58,16 +67,308 @@ std::pair< cvector_t, cmatrix_t > eig( const cmatrix_t &mat ) {
     lapack::geev( temp, vals, dummy, &right_vecs, lapack::optimal_workspace() );
     return std::make_pair( vals, right_vecs ); }
 
+// --------------------------------------------------------------------
+// RPA structured solvers
+// --------------------------------------------------------------------
+// Writing the RPA matrix as S H, with S = diag( 1, -1 ) and
+//      H = [  A   -B* ]
+//          [ -B    A* ]
+// H is symmetric, and whenever a positive definite matrix can be split off
+// the eigenvalues are those of a symmetric problem.
+
+// Relative tolerance used when checking the block structure.
+const double structure_tolerance = 1e-12;
+
+double max_abs( const matrix_t &m ) {
+    double result = 0;
+    for ( unsigned int i = 0; i < m.size1(); ++i ) {
+        for ( unsigned int k = 0; k < m.size2(); ++k ) {
+            result = std::max( result, std::abs( m( i, k ) ) ); } }
+    return result; }
+
+bool nearly_equal( const matrix_t &a, const matrix_t &b, double tolerance ) {
+    for ( unsigned int i = 0; i < a.size1(); ++i ) {
+        for ( unsigned int k = 0; k < a.size2(); ++k ) {
+            if ( std::abs( a( i, k ) - b( i, k ) ) > tolerance )
+                return false; } }
+    return true; }
+
+// Returns true and sets L (lower triangular, m = L L^T) if m is positive
+// definite.
+bool cholesky( const matrix_t &m, matrix_t &L ) {
+    // Cheap necessary condition first
+    for ( unsigned int i = 0; i < m.size1(); ++i ) {
+        if ( m( i, i ) <= 0 )
+            return false; }
+    L = m;
+    if ( 0 != lapack::potrf( 'L', L ) )
+        return false;
+    for ( unsigned int i = 0; i < L.size1(); ++i ) {
+        for ( unsigned int k = i + 1; k < L.size2(); ++k ) {
+            L( i, k ) = 0; } }
+    return true; }
+
+// Eigenvalues of the symmetric matrix m.
+vector_t symmetric_eigenvalues( const matrix_t &m ) {
+    vector_t vals( m.size1() );
+    matrix_t temp( m );
+    lapack::syev( 'N', 'U', temp, vals, lapack::optimal_workspace() );
+    return vals; }
+
+std::pair< vector_t, matrix_t > symmetric_eig( const matrix_t &m ) {
+    vector_t vals( m.size1() );
+    matrix_t vecs( m );
+    lapack::syev( 'V', 'U', vecs, vals, lapack::optimal_workspace() );
+    return std::make_pair( vals, vecs ); }
+
+// A* == A and B* == B:  the eigenvalues are +/- w, where w^2 are the
+// eigenvalues of (A - B)(A + B), or equivalently L^T (A + B) L with
+// L L^T = A - B (or the same with A + B and A - B swapped).
+bool half_size_rpa_eigenvalues( const matrix_t &A, const matrix_t &B,
+                                cvector_t &vals ) {
+    int size = A.size1();
+    matrix_t L;
+    matrix_t X;
+    if ( cholesky( A - B, L ) )
+        X = A + B;
+    else if ( cholesky( A + B, L ) )
+        X = A - B;
+    else
+        return false;
+
+    matrix_t XL( ublas::prod( X, L ) );
+    vector_t w2 = symmetric_eigenvalues(
+            matrix_t( ublas::prod( ublas::trans( L ), XL ) ) );
+
+    vals.resize( 2 * size );
+    for ( int i = 0; i < size; ++i ) {
+        complex_t w = w2( i ) >= 0 ? complex_t( std::sqrt( w2( i ) ), 0 )
+                                   : complex_t( 0, std::sqrt( -w2( i ) ) );
+        vals( i )        =  w;
+        vals( size + i ) = -w; }
+    return true; }
+
+// Cholesky factor of H, if it is positive definite.  A and A* are the
+// diagonal blocks of H, and are much cheaper to rule out first.
+bool rpa_cholesky( const matrix_t &A, const matrix_t &A_star,
+                   const matrix_t &H, matrix_t &L ) {
+    matrix_t block_L;
+    return cholesky( A, block_L ) && cholesky( A_star, block_L )
+        && cholesky( H, L ); }
+
+// H positive definite:  with H = L L^T, S H is similar to L^T S L.
+bool definite_rpa_eigenvalues( const matrix_t &A, const matrix_t &A_star,
+                               const matrix_t &H, cvector_t &vals ) {
+    int size = H.size1() / 2;
+    matrix_t L;
+    if ( !rpa_cholesky( A, A_star, H, L ) )
+        return false;
+
+    matrix_t SL( L );
+    ublas::matrix_range< matrix_t >( SL,
+            ublas::range( size, 2 * size ), ublas::range( 0, 2 * size ) )
+        *= -1;
+    vector_t w = symmetric_eigenvalues(
+            matrix_t( ublas::prod( ublas::trans( L ), SL ) ) );
+
+    vals.resize( 2 * size );
+    for ( int i = 0; i < 2 * size; ++i ) {
+        vals( i ) = w( i ); }
+    return true; }
+
+// Exits on the first mismatch, which is the common case for matrices
+// without the structure.
+bool has_rpa_structure( const matrix_t &mat ) {
+    if ( mat.size1() != mat.size2() || 0 != mat.size1() % 2 ||
+         0 == mat.size1() )
+        return false;
+
+    int size = mat.size1();
+    double tolerance = structure_tolerance * max_abs( mat );
+    for ( int k = 0; k < size; ++k ) {
+        for ( int i = k + 1; i < size; ++i ) {
+            double ik = i < size / 2 ? mat( i, k ) : -mat( i, k );
+            double ki = k < size / 2 ? mat( k, i ) : -mat( k, i );
+            if ( std::abs( ik - ki ) > tolerance )
+                return false; } }
+    return true; }
+
+// Sets H = S mat, returning false unless it is symmetric.
+bool rpa_hamiltonian( const matrix_t &mat, matrix_t &H ) {
+    if ( !has_rpa_structure( mat ) )
+        return false;
+
+    int size = mat.size1();
+    H = mat;
+    ublas::matrix_range< matrix_t >( H, ublas::range( size / 2, size ),
+            ublas::range( 0, size ) ) *= -1;
+    return true; }
+
+typedef ublas::matrix_range< const matrix_t > submatrix_t;
+
+cvector_t rpa_eigenvalues( const matrix_t &mat ) {
+    matrix_t H;
+    if ( !rpa_hamiltonian( mat, H ) )
+        return eigenvalues( mat );
+
+    int size = mat.size1() / 2;
+    ublas::range first_half( 0, size );
+    ublas::range second_half( size, 2*size );
+    matrix_t A     (  submatrix_t( H, first_half,  first_half ) );
+    matrix_t A_star(  submatrix_t( H, second_half, second_half ) );
+    matrix_t B     ( -submatrix_t( H, second_half, first_half ) );
+    matrix_t B_star( -submatrix_t( H, first_half,  second_half ) );
+
+    double tolerance = structure_tolerance * max_abs( mat );
+    cvector_t vals;
+    if ( nearly_equal( A, A_star, tolerance ) &&
+         nearly_equal( B, B_star, tolerance ) &&
+         half_size_rpa_eigenvalues( A, B, vals ) )
+        return vals;
+
+    if ( definite_rpa_eigenvalues( A, A_star, H, vals ) )
+        return vals;
+
+    return eigenvalues( mat ); }
+
+// Reads the inertia off the block diagonal D of a Bunch-Kaufman
+// factorization (1x1 and 2x2 blocks).
+boost::tuple< int, int, int > inertia( const matrix_t &m ) {
+    matrix_t LD( m );
+    std::vector< int > ipiv( m.size1() );
+    lapack::sytrf( 'L', LD, ipiv );
+
+    int num_negative = 0;
+    int num_zero     = 0;
+    int num_positive = 0;
+    int size = m.size1();
+    for ( int k = 0; k < size; ++k ) {
+        if ( ipiv[k] > 0 || k + 1 == size ) {
+            if ( LD( k, k ) < 0 )
+                ++num_negative;
+            else if ( LD( k, k ) > 0 )
+                ++num_positive;
+            else
+                ++num_zero; }
+        else {
+            double det = LD( k, k ) * LD( k + 1, k + 1 )
+                       - LD( k + 1, k ) * LD( k + 1, k );
+            double trace = LD( k, k ) + LD( k + 1, k + 1 );
+            if ( det < 0 ) {
+                ++num_negative;
+                ++num_positive; }
+            else if ( det > 0 ) {
+                if ( trace < 0 )
+                    num_negative += 2;
+                else
+                    num_positive += 2; }
+            else {
+                ++num_zero;
+                if ( trace < 0 )
+                    ++num_negative;
+                else if ( trace > 0 )
+                    ++num_positive;
+                else
+                    ++num_zero; }
+            ++k; } }
+    return boost::make_tuple( num_negative, num_zero, num_positive ); }
+
+// With H = L L^T positive definite, H - E S = L ( 1 - E L^-1 S L^-T ) L^T
+// and L^-1 S L^-T has the eigenvalues 1 / w of S H.  So the negative
+// eigenvalues of H - E S are the w between 0 and E.
+bool rpa_count_values( const matrix_t &mat, double E,
+                       boost::tuple< int, int > &count ) {
+    matrix_t H;
+    if ( !rpa_hamiltonian( mat, H ) )
+        return false;
+
+    int size = mat.size1() / 2;
+    ublas::range first_half( 0, size );
+    ublas::range second_half( size, 2*size );
+    matrix_t L;
+    if ( !rpa_cholesky( submatrix_t( H, first_half,  first_half ),
+                        submatrix_t( H, second_half, second_half ), H, L ) )
+        return false;
+
+    matrix_t shifted( H );
+    for ( int i = 0; i < size; ++i ) {
+        shifted( i, i )               -= E;
+        shifted( size + i, size + i ) += E; }
+
+    boost::tuple< int, int, int > in = inertia( shifted );
+    int between = in.get<0>();
+    int at      = in.get<1>();
+    if ( E >= 0 )
+        count = boost::make_tuple( size - between - at, size + between );
+    else
+        count = boost::make_tuple( size + between, size - between - at );
+    return true; }
+
 // Returns the real parts of the eigenvalues, sorted.
 std::vector< double >
 sorted_eigenvalues( const matrix_t &m ) {
-    cvector_t vals = eigenvalues( m );
+    cvector_t vals = rpa_eigenvalues( m );
     std::vector< double > results;
     BOOST_FOREACH( const util::complex_t &v, vals ) {
         results.push_back( v.real() ); }
     std::sort( results.begin(), results.end() );
     return results; }
 
+// Approximate eigenvector of the LU factored m - w 1 (or of its transpose)
+// by inverse iteration.  Two steps are plenty when w is an eigenvalue.
+vector_t inverse_iteration( const matrix_t &LU, const std::vector< int > &ipiv,
+                            char trans ) {
+    // A start without any structure, so it is unlikely to miss the vector.
+    matrix_t x( LU.size1(), 1 );
+    for ( unsigned int i = 0; i < x.size1(); ++i ) {
+        x( i, 0 ) = 1.0 / ( 1 + i ); }
+    for ( int step = 0; step < 2; ++step ) {
+        lapack::getrs( trans, LU, ipiv, x );
+        double norm = ublas::norm_inf( ublas::column( x, 0 ) );
+        if ( 0 == norm || !( norm < std::numeric_limits< double >::max() ) )
+            break;
+        x /= norm; }
+    return ublas::column( x, 0 ); }
+
+// First order perturbation theory for a non-symmetric matrix:
+//      d lambda = y^T dm x / y^T x
+// with x and y the right and left eigenvectors of lambda.  The eigenvectors
+// come from inverse iteration, which is much cheaper than asking geev for
+// them.
+bool sorted_eigenvalue_slope( const matrix_t &m, const matrix_t &dm,
+                              int index, double &value, double &slope ) {
+    int size = m.size1();
+    if ( index < 0 || index >= size )
+        return false;
+    cvector_t vals = eigenvalues( m );
+
+    std::vector< std::pair< double, int > > order;
+    for ( int i = 0; i < size; ++i ) {
+        order.push_back( std::make_pair( vals( i ).real(), i ) ); }
+    std::sort( order.begin(), order.end() );
+    int k = order[ index ].second;
+    value = order[ index ].first;
+    if ( 0 != vals( k ).imag() )
+        return false;
+
+    // Shift slightly off the eigenvalue to keep the factorization regular.
+    matrix_t LU( m );
+    double shift = value + 1e-10 * ( 1 + std::abs( value ) );
+    for ( int i = 0; i < size; ++i ) {
+        LU( i, i ) -= shift; }
+    std::vector< int > ipiv( size );
+    if ( 0 != lapack::getrf( LU, ipiv ) )
+        return false;
+
+    vector_t x = inverse_iteration( LU, ipiv, 'N' );
+    vector_t y = inverse_iteration( LU, ipiv, 'T' );
+    double overlap = ublas::inner_prod( y, x );
+    if ( 0 == overlap )
+        return false;
+    vector_t dx = ublas::prod( dm, x );
+    slope = ublas::inner_prod( y, dx ) / overlap;
+    return ( boost::math::isfinite )( slope ); }
+
     /*
 // Returns both eigenvalues and eigenvectors, sorted by the eigenvalues.
 std::vector< std::pair< util::complex_t, util::cvector_t > >
@@ -7,6 +7,9 @@
 #define _UTIL_LINALG_H_
 
 #include <complex>
+#include <vector>
+
+#include <boost/tuple/tuple.hpp>
 
 #include <boost/numeric/ublas/matrix.hpp>
 #include <boost/numeric/ublas/vector.hpp>
@@ -35,9 +38,44 @@ std::pair< cvector_t, matrix_t > eig( const matrix_t &mat );
 cvector_t eigenvalues( const cmatrix_t &mat );
 std::pair< cvector_t, cmatrix_t > eig( const cmatrix_t &mat );
 
+// Eigenvalues (ascending) and eigenvectors of a symmetric matrix.
+std::pair< vector_t, matrix_t > symmetric_eig( const matrix_t &m );
+
+// RPA structured solver.  Takes a matrix with the block layout
+//      [  A   -B* ]
+//      [  B   -A* ]
+// used by MatrixFactory.  When A* == A and B* == B the +/- pairs come
+// from an N x N symmetric problem, otherwise a symmetric 2N x 2N problem is
+// used when possible.  Falls back on the general solver (geev) when the
+// matrix does not have the required structure.
+cvector_t rpa_eigenvalues( const matrix_t &mat );
+
+// True when mat has the layout above with A and A* symmetric and
+// B* == B^T, that is when S mat is symmetric.
+bool has_rpa_structure( const matrix_t &mat );
+
+// Inertia ( # negative, # zero, # positive ) of the symmetric matrix m,
+// from an LDL^T factorization.
+boost::tuple< int, int, int > inertia( const matrix_t &m );
+
+// Counts the eigenvalues of an RPA matrix (layout as above) that lie
+// ( above, below ) E, using the inertia of H - E S instead of solving for
+// them.  Returns false, leaving count alone, unless H is positive
+// definite.
+bool rpa_count_values( const matrix_t &mat, double E,
+                       boost::tuple< int, int > &count );
+
+// Real parts of rpa_eigenvalues, sorted.
 std::vector< double >
 sorted_eigenvalues( const matrix_t &m );
 
+// Sets value to the index'th of the sorted eigenvalues of m, and slope to
+// its derivative along dm (Hellmann-Feynman, using left and right
+// eigenvectors from inverse iteration).  Returns false, without the slope,
+// if the eigenvalue is complex.
+bool sorted_eigenvalue_slope( const matrix_t &m, const matrix_t &dm,
+                              int index, double &value, double &slope );
+
 } // end namespace util
 
 #endif // _UTIL_LINALG_H_
@@ -1,3 +1,4 @@
+#include <cassert>
 #include <string>
 #include <list>
 
@@ -220,6 +221,89 @@ build_ph_shells_from_sp( const SingleParticleModelspace &spms ) {
                                     -1, -1, J ) ); } } } } }
     return phms; }
 
+// --------------------------------------------------------------------
+// Flat channel factories
+// --------------------------------------------------------------------
+namespace {
+// Copies the layout of a [tz+1][(parity+1)/2][J][i] modelspace, leaving the
+// per state arrays to the caller.
+template < class State >
+StateChannels build_channel_layout(
+        const std::vector< std::vector< std::vector<
+            std::vector< State > > > > &ms ) {
+    StateChannels result;
+    result.first_J.assign( 1, 0 );
+    result.offsets.assign( 1, 0 );
+    for ( int tz = -1; tz <= 1; ++tz ) {
+        for ( int parity = -1; parity <= 1; parity += 2 ) {
+            assert( StateChannels::block( tz, parity )
+                    == static_cast<int>(result.first_J.size()) - 1 );
+            const std::vector< std::vector< State > > &channels
+                = ms[ tz + 1 ][ (parity + 1)/2 ];
+            BOOST_FOREACH( const std::vector< State > &states, channels ) {
+                result.offsets.push_back(
+                        result.offsets.back() + states.size() ); }
+            result.first_J.push_back(
+                    result.first_J.back() + channels.size() ); } }
+    int size = result.offsets.back();
+    result.i1.reserve( size );
+    result.i2.reserve( size );
+    result.E.reserve( size );
+    result.S.reserve( size );
+    return result; }
+} // end anonymous namespace
+
+StateChannels
+build_ph_channels( const ParticleHoleModelspace     &phms,
+                   const SingleParticleModelspace   &spms ) {
+    StateChannels result = build_channel_layout( phms );
+    for ( int tz = -1; tz <= 1; ++tz ) {
+        for ( int parity = -1; parity <= 1; parity += 2 ) {
+            BOOST_FOREACH( const std::vector< ParticleHoleState > &states,
+                           phms[ tz + 1 ][ (parity + 1)/2 ] ) {
+                BOOST_FOREACH( const ParticleHoleState &ph, states ) {
+                    const Fragment &p = spms.pfrag[ ph.ip ][ ph.ipf ];
+                    const Fragment &h = spms.hfrag[ ph.ih ][ ph.ihf ];
+                    result.i1.push_back( ph.ip );
+                    result.i2.push_back( ph.ih );
+                    result.E.push_back( p.E - h.E );
+                    result.S.push_back( p.S * h.S ); } } } }
+    return result; }
+
+StateChannels
+build_pp_channels( const ParticleParticleModelspace &ppms,
+                   const SingleParticleModelspace   &spms ) {
+    StateChannels result = build_channel_layout( ppms );
+    for ( int tz = -1; tz <= 1; ++tz ) {
+        for ( int parity = -1; parity <= 1; parity += 2 ) {
+            BOOST_FOREACH( const std::vector< ParticleParticleState > &states,
+                           ppms[ tz + 1 ][ (parity + 1)/2 ] ) {
+                BOOST_FOREACH( const ParticleParticleState &pp, states ) {
+                    const Fragment &p1 = spms.pfrag[ pp.ip1 ][ pp.ip1f ];
+                    const Fragment &p2 = spms.pfrag[ pp.ip2 ][ pp.ip2f ];
+                    result.i1.push_back( pp.ip1 );
+                    result.i2.push_back( pp.ip2 );
+                    result.E.push_back( p1.E + p2.E );
+                    result.S.push_back( p1.S * p2.S ); } } } }
+    return result; }
+
+StateChannels
+build_hh_channels( const ParticleParticleModelspace &hhms,
+                   const SingleParticleModelspace   &spms ) {
+    StateChannels result = build_channel_layout( hhms );
+    for ( int tz = -1; tz <= 1; ++tz ) {
+        for ( int parity = -1; parity <= 1; parity += 2 ) {
+            BOOST_FOREACH( const std::vector< ParticleParticleState > &states,
+                           hhms[ tz + 1 ][ (parity + 1)/2 ] ) {
+                BOOST_FOREACH( const ParticleParticleState &hh, states ) {
+                    const Fragment &h1 = spms.hfrag[ hh.ip1 ][ hh.ip1f ];
+                    const Fragment &h2 = spms.hfrag[ hh.ip2 ][ hh.ip2f ];
+                    result.i1.push_back( hh.ip1 );
+                    result.i2.push_back( hh.ip2 );
+                    result.E.push_back( h1.E + h2.E );
+                    result.S.push_back( h1.S * h2.S ); } } } }
+    return result; }
+
 // --------------------------------------------------------------------
 // Self energy modelspace factories
 // --------------------------------------------------------------------
@@ -21,6 +21,19 @@ build_ph_modelspace_from_sp( const SingleParticleModelspace &spms );
 ParticleHoleModelspace
 build_ph_shells_from_sp( const SingleParticleModelspace &spms );
 
+// Flat copies of the above for the dynamic terms
+StateChannels
+build_ph_channels( const ParticleHoleModelspace     &phms,
+                   const SingleParticleModelspace   &spms );
+
+StateChannels
+build_pp_channels( const ParticleParticleModelspace &ppms,
+                   const SingleParticleModelspace   &spms );
+
+StateChannels
+build_hh_channels( const ParticleParticleModelspace &hhms,
+                   const SingleParticleModelspace   &spms );
+
 // Modelspace used only in self-energy terms
 PPFromSP
 build_ppsp_modelspace_from_sp( const SingleParticleModelspace &spms );
@@ -5,18 +5,31 @@
 
 #include <cassert>
 #include <cmath>
+#include <vector>
+#include <algorithm>
 
 #include "Modelspace.h"
 #include "Interaction.h"
+#include "InteractionTable.h"
 #include "pandya.h"
 
 #include "angular_momentum.h"
 
+// An empty table, which calculates every symbol.
+const Wigner6jTable no_table;
+
 // Performs a Pandya transformation (two particle to particle hole).
 double pandya( const PPInteraction &G_pp,
                const SingleParticleModelspace &spms,
                const ParticleHoleState &A,
                const ParticleHoleState &B ) {
+    return pandya( G_pp, spms, no_table, A, B ); }
+
+double pandya( const PPInteraction &G_pp,
+               const SingleParticleModelspace &spms,
+               const Wigner6jTable &sixj,
+               const ParticleHoleState &A,
+               const ParticleHoleState &B ) {
     int ia = A.ip;
     int ib = A.ih;
     int ic = B.ip;
@@ -40,10 +53,39 @@ double pandya( const PPInteraction &G_pp,
 
         double phase = std::pow(-1.0, spms.j[ib] + spms.j[ic] + Jp);
         double temp = phase * (2*Jp + 1) * G_pp(pp_A, pp_B) *
-            wigner6j( spms.j[ia], spms.j[ib], A.J,
-                      spms.j[ic], spms.j[id], Jp );
+            sixj( spms.j[ia], spms.j[ib], A.J,
+                  spms.j[ic], spms.j[id], Jp );
         elem += temp;
     }
 
     return elem;
 }
+
+void pandya( const PPInteractionTable &G_pp,
+             const SingleParticleModelspace &spms,
+             const Wigner6jTable &sixj,
+             int ia, int ib, int ic, int id,
+             std::vector< double > &elems ) {
+    std::fill( elems.begin(), elems.end(), 0.0 );
+    int Jmin = static_cast<int>( std::max( std::abs( spms.j[ia] - spms.j[ib] ),
+                                           std::abs( spms.j[ic] - spms.j[id] ) ) );
+    int Jmax = std::min( static_cast<int>( elems.size() ) - 1,
+            static_cast<int>( std::min( spms.j[ia] + spms.j[ib],
+                                        spms.j[ic] + spms.j[id] ) ) );
+
+    int Jpmin = std::max( std::abs( spms.j[ia] - spms.j[id] ),
+                          std::abs( spms.j[ib] - spms.j[ic] ) );
+    int Jpmax = std::min( spms.j[ia] + spms.j[id],
+                          spms.j[ic] + spms.j[ib] );
+
+    // Same order of operations as the single J version.
+    for ( int Jp = Jpmin; Jp <= Jpmax && Jmin <= Jmax; ++Jp ) {
+        ParticleParticleState pp_A( ia, id, -1, -1, Jp );
+        ParticleParticleState pp_B( ib, ic, -1, -1, Jp );
+
+        double phase = std::pow(-1.0, spms.j[ib] + spms.j[ic] + Jp);
+        double weight = phase * (2*Jp + 1) * G_pp(pp_A, pp_B);
+        for ( int J = Jmin; J <= Jmax; ++J ) {
+            elems[J] += weight * sixj( spms.j[ia], spms.j[ib], J,
+                                       spms.j[ic], spms.j[id], Jp ); } }
+}
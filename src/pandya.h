@@ -1,12 +1,32 @@
 #ifndef _NUCLEAR_PANDYA_H_
 #define _NUCLEAR_PANDYA_H_
 
+#include <vector>
+
 #include "Modelspace.h"
 #include "Interaction.h"
+#include "InteractionTable.h"
+#include "angular_momentum.h"
 
 double pandya( const PPInteraction &G_pp,
                const SingleParticleModelspace &spms,
                const ParticleHoleState &A,
                const ParticleHoleState &B );
 
+// Same, with the 6j symbols looked up in sixj.
+double pandya( const PPInteraction &G_pp,
+               const SingleParticleModelspace &spms,
+               const Wigner6jTable &sixj,
+               const ParticleHoleState &A,
+               const ParticleHoleState &B );
+
+// Same for A = ( ia, ib ), B = ( ic, id ) and every J < elems.size() at
+// once; the G_pp elements do not depend on J, so each is looked up only
+// once.  elems[J] is 0 where J does not couple both A and B.
+void pandya( const PPInteractionTable &G_pp,
+             const SingleParticleModelspace &spms,
+             const Wigner6jTable &sixj,
+             int ia, int ib, int ic, int id,
+             std::vector< double > &elems );
+
 #endif // _NUCLEAR_PANDYA_H_
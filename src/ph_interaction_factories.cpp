@@ -2,22 +2,28 @@
 #include <string>
 #include <vector>
 #include <fstream>
+#include <utility>
+#include <algorithm>
 
 #include <boost/tuple/tuple.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/bind.hpp>
+#include <boost/foreach.hpp>
 #include <boost/numeric/conversion/cast.hpp>
 #include <boost/numeric/ublas/matrix.hpp>
 #include <boost/numeric/ublas/symmetric.hpp>
 
 #include "io.h"
 #include "Interaction.h"
+#include "InteractionTable.h"
 #include "Modelspace.h"
 #include "ph_interaction_factories.h"
+#include "pp_interaction_factories.h"
 #include "modelspace_factories.h"
 #include "angular_momentum.h"
 #include "pandya.h"
 #include "exceptions.h"
+#include "scheduler.h"
 
 namespace ublas = boost::numeric::ublas;
 
@@ -25,34 +31,6 @@ namespace ublas = boost::numeric::ublas;
 // Support functions for the PH Interaction factories
 // --------------------------------------------------------------------
 
-// PH interaction elements
-typedef std::vector< std::vector< std::vector<
-    ublas::symmetric_matrix< double >
-> > > PHMatricies;
-
-// Format: indices[tz+1][(parity+1)/2][J]( ip, ih )
-typedef std::vector< std::vector< std::vector<
-    ublas::matrix< int >
-> > > PHIndices;
-
-double ph_interaction_base( const ParticleHoleState    &A,
-                            const ParticleHoleState    &B,
-                            const PHMatricies             &matricies,
-                            const PHIndices               &indices,
-                            const SingleParticleModelspace &spms ) {
-    int tz     = spms.tz[ A.ip ]     - spms.tz[ A.ih ];
-    int parity = spms.parity[ A.ip ] * spms.parity[ A.ih ];
-
-    assert( tz     == spms.tz[ B.ip ]     - spms.tz[ B.ih ] );
-    assert( parity == spms.parity[ B.ip ] * spms.parity[ B.ih ] );
-    assert( A.J    == B.J );
-
-    int iA = indices[ tz + 1 ][ (parity+1)/2 ][ A.J ]( A.ip, A.ih );
-    int iB = indices[ tz + 1 ][ (parity+1)/2 ][ A.J ]( B.ip, B.ih );
-
-    return matricies[ tz + 1 ][ (parity+1)/2 ][ A.J ]( iA, iB );
-}
-
 ublas::matrix< int >
 make_ph_indices( const std::vector< ParticleHoleState > &shell,
                  const SingleParticleModelspace &spms ) {
@@ -87,38 +65,80 @@ build_ph_indices( const ParticleHoleModelspace   &shells,
     return indices;
 }
 
-PHMatricies
-build_ph_matricies_from_pp( const PPInteraction &Gpp,
+// The distinct ( ip, ih ) pairs of every J channel of one tz and parity, in
+// the order of the channels.
+std::vector< std::pair< int, int > >
+get_ph_pairs( const std::vector< std::vector< ParticleHoleState > > &shells ) {
+    std::vector< std::pair< int, int > > pairs;
+    BOOST_FOREACH( const std::vector< ParticleHoleState > &shell, shells ) {
+        BOOST_FOREACH( const ParticleHoleState &ph, shell ) {
+            pairs.push_back( std::make_pair( ph.ip, ph.ih ) ); } }
+    std::sort( pairs.begin(), pairs.end() );
+    pairs.erase( std::unique( pairs.begin(), pairs.end() ), pairs.end() );
+    return pairs;
+}
+
+// Fills row P = pairs[ row ] of every J channel, for the columns from row
+// on.  Rows set disjoint elements, so they can be filled concurrently.
+// Each element is evaluated as pandya( Gpp, spms, pairs[ col ], P ), which
+// is what the full loop over the symmetric matrix used to leave behind.
+void fill_ph_row( int row, int tz, int parity,
+                  const std::vector< std::pair< int, int > > &pairs,
+                  const PPInteractionTable &Gpp,
+                  const Wigner6jTable &sixj,
+                  const std::vector< ublas::matrix< int > > &indices,
+                  PHInteractionTable &Gph,
+                  const SingleParticleModelspace &spms ) {
+    int ip = pairs[ row ].first;
+    int ih = pairs[ row ].second;
+    std::vector< double > elems( indices.size() );
+    for ( int col = row; col < static_cast<int>(pairs.size()); ++col ) {
+        int jp = pairs[ col ].first;
+        int jh = pairs[ col ].second;
+        pandya( Gpp, spms, sixj, jp, jh, ip, ih, elems );
+        for ( int J = 0; J < static_cast<int>(indices.size()); ++J ) {
+            int iA = indices[ J ]( ip, ih );
+            int iB = indices[ J ]( jp, jh );
+            if ( iA >= 0 && iB >= 0 )
+                Gph.set( tz, parity, J, iA, iB, elems[ J ] ); } }
+}
+
+// Each unique element is computed once, all J of a shell quadruple
+// together, with the rows of all channels spread over num_threads.
+void fill_ph_table_from_pp( const PPInteractionTable &Gpp,
                             const PHIndices &indices,
                             const SingleParticleModelspace &spms,
-                            const ParticleHoleModelspace &shells ) {
-    PHMatricies matricies(3); matricies.resize(3);
+                            const Wigner6jTable &sixj,
+                            const ParticleHoleModelspace &shells,
+                            int num_threads,
+                            PHInteractionTable &Gph ) {
+    std::vector< std::vector< std::vector< std::pair< int, int > > > >
+        pairs(3);
+    TaskPool pool( num_threads );
     for ( int tz = -1; tz <= 1; ++tz ) {
-        matricies[ tz + 1 ].resize(2); // resize parity
+        pairs[ tz + 1 ].resize(2);
         for ( int parity = -1; parity <= 1; parity += 2 ) {
-            matricies[ tz + 1 ][ (parity + 1)/2 ].resize( // resize J
-                    indices[ tz + 1 ][ (parity + 1)/2 ].size() );
-            for ( int J = 0;
-                    J < static_cast<int>(matricies[tz+1][(parity+1)/2].size());
-                    ++J ) {
-                std::vector< ParticleHoleState > shell
-                    = shells[ tz + 1 ][ (parity + 1)/2 ][ J ];
-                int size = shell.size();
-                ublas::symmetric_matrix< double > m( size, size );
-                m.clear();
-                for ( int i = 0; i < size; ++i ) {
-                    for ( int j = 0; j < size; ++j ) {
-                        m( i, j ) = pandya( Gpp, spms, shell[i], shell[j] );
-                        matricies[ tz + 1 ][ (parity + 1)/2 ][ J ] = m; }} } } }
-    return matricies;
+            pairs[ tz + 1 ][ (parity + 1)/2 ]
+                = get_ph_pairs( shells[ tz + 1 ][ (parity + 1)/2 ] );
+            for ( int row = 0;
+                    row < static_cast<int>(pairs[tz+1][(parity+1)/2].size());
+                    ++row ) {
+                pool.submit( boost::bind( fill_ph_row, row, tz, parity,
+                            boost::cref( pairs[ tz + 1 ][ (parity + 1)/2 ] ),
+                            boost::cref( Gpp ), boost::cref( sixj ),
+                            boost::cref( indices[ tz + 1 ][ (parity + 1)/2 ] ),
+                            boost::ref( Gph ), boost::cref( spms ) ) ); } } }
+    pool.run();
 }
 
 // --------------------------------------------------------------------
 // Actual PH Interaction
 // --------------------------------------------------------------------
-PHInteraction
-build_ph_interaction_from_pp( const PPInteraction &Gpp,
-                              const SingleParticleModelspace &spms ) {
+PHInteractionTable
+build_ph_table_from_pp( const PPInteraction &Gpp,
+                        const SingleParticleModelspace &spms,
+                        const Wigner6jTable &sixj,
+                        int num_threads ) {
     // build shells
     ParticleHoleModelspace shells = build_ph_shells_from_sp( spms );
 
@@ -127,9 +147,37 @@ build_ph_interaction_from_pp( const PPInteraction &Gpp,
     indices = build_ph_indices( shells, spms );
 
     // build matricies
-    PHMatricies matricies = build_ph_matricies_from_pp( Gpp, indices,
-            spms, shells );
+    PHInteractionTable Gph( indices, shells, spms );
+    fill_ph_table_from_pp( as_pp_table( Gpp, spms ), indices, spms, sixj,
+                           shells, num_threads, Gph );
+    return Gph;
+}
+
+PHInteraction
+build_ph_interaction_from_pp( const PPInteraction &Gpp,
+                              const SingleParticleModelspace &spms,
+                              const Wigner6jTable &sixj,
+                              int num_threads ) {
+    return build_ph_table_from_pp( Gpp, spms, sixj, num_threads ); }
+
+PHInteractionTable as_ph_table( const PHInteraction &Gph,
+                                const SingleParticleModelspace &spms ) {
+    if ( const PHInteractionTable *table = Gph.target< PHInteractionTable >() )
+        return *table;
 
-    return boost::bind( ph_interaction_base, _1, _2,
-            matricies, indices, spms );
+    ParticleHoleModelspace shells = build_ph_shells_from_sp( spms );
+    PHIndices indices = build_ph_indices( shells, spms );
+    PHInteractionTable result( indices, shells, spms );
+    for ( int tz = -1; tz <= 1; ++tz ) {
+        for ( int parity = -1; parity <= 1; parity += 2 ) {
+            for ( int J = 0;
+                    J < static_cast<int>(shells[tz+1][(parity+1)/2].size());
+                    ++J ) {
+                const std::vector< ParticleHoleState > &shell
+                    = shells[ tz + 1 ][ (parity + 1)/2 ][ J ];
+                for ( int a = 0; a < static_cast<int>(shell.size()); ++a ) {
+                    for ( int b = a; b < static_cast<int>(shell.size()); ++b ) {
+                        result.set( tz, parity, J, a, b,
+                                    Gph( shell[a], shell[b] ) ); } } } } }
+    return result;
 }
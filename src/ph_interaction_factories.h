@@ -2,10 +2,28 @@
 #define _PH_INTERACTION_FACTORIES_H_
 
 #include "Interaction.h"
+#include "InteractionTable.h"
 #include "Modelspace.h"
+#include "angular_momentum.h"
 
+// The channels are filled using num_threads threads, with the 6j symbols
+// of the Pandya transformation looked up in sixj.
 PHInteraction
 build_ph_interaction_from_pp( const PPInteraction &Gpp,
-                              const SingleParticleModelspace &spms );
+                              const SingleParticleModelspace &spms,
+                              const Wigner6jTable &sixj,
+                              int num_threads = 1 );
+
+// Same, as the concrete table the term kernels use.
+PHInteractionTable
+build_ph_table_from_pp( const PPInteraction &Gpp,
+                        const SingleParticleModelspace &spms,
+                        const Wigner6jTable &sixj,
+                        int num_threads = 1 );
+
+// Returns the table inside Gph if there is one, and otherwise tabulates
+// Gph.
+PHInteractionTable as_ph_table( const PHInteraction &Gph,
+                                const SingleParticleModelspace &spms );
 
 #endif // _PH_INTERACTION_FACTORIES_H_
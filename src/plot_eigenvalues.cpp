@@ -3,7 +3,10 @@
 #include <string>
 
 #include <boost/foreach.hpp>
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
 #include <boost/numeric/ublas/io.hpp>
+#include <boost/thread/thread.hpp>
 
 #include <boost/program_options/variables_map.hpp>
 #include <boost/program_options/options_description.hpp>
@@ -20,9 +23,17 @@
 #include "ph_interaction_factories.h"
 #include "pp_interaction_factories.h"
 #include "term_factories.h"
+#include "sampling.h"
 
 namespace po = boost::program_options;
 
+// The values plotted at every energy in E.  The sampler never asks for an
+// energy twice, so the eigenvalue cache is left out.
+std::vector< std::vector< double > >
+plot_values( const MatrixFactory &mf, int num_threads,
+             const std::vector< double > &E ) {
+    return mf.compute_sorted_eigenvalues( E, num_threads ); }
+
 int main( int argc, char *argv[] ) {
 
     // Options parsed by the command line
@@ -50,7 +61,24 @@ int main( int argc, char *argv[] ) {
     config_desc.add_options()
         ("interaction_file", po::value<std::string>(), "Interaction filename.")
         ("modelspace_file",  po::value<std::string>(), "Modelspace filename.")
-        ("output_file",      po::value<std::string>(), "Full output filename.");
+        ("output_file",      po::value<std::string>(), "Full output filename.")
+        ("gmatrix_cache",    po::value<bool>()->default_value( false ),
+                             "Keep a binary copy of the interaction file "
+                             "next to it, read instead on later runs.")
+        ("num_threads",      po::value<int>()->default_value(
+                    boost::thread::hardware_concurrency() ),
+                             "Number of matricies diagonalized at once.")
+        ("E_min",            po::value<double>()->default_value( -10 ),
+                             "Lowest energy plotted.")
+        ("E_max",            po::value<double>()->default_value( 10 ),
+                             "Highest energy plotted.")
+        ("plot_step",        po::value<double>()->default_value( 0.05 ),
+                             "Spacing of the initial energy grid.")
+        ("min_plot_step",    po::value<double>()->default_value( 0.002 ),
+                             "Smallest spacing the grid is refined to.")
+        ("plot_tolerance",   po::value<double>()->default_value( 0.01 ),
+                             "Largest distance of an eigenvalue from the "
+                             "line between its neighbours.");
     po::variables_map config_vm;
     {   std::ifstream cfile(cmdline_vm["config"].as<std::string>().c_str());
         po::store( po::parse_config_file( cfile,
@@ -81,23 +109,37 @@ int main( int argc, char *argv[] ) {
 
     std::cout << "Modelspaces built.  PH modelspace sizes:" << std::endl;
 
+    // One table of 6j symbols for the Pandya transformation and every term
+    boost::shared_ptr< const Wigner6jTable > sixj(
+            new Wigner6jTable( spms.maxj ) );
+    // The states of every channel, shared by every term
+    boost::shared_ptr< const StateChannels > phc(
+            new StateChannels( build_ph_channels( phms, spms ) ) );
+    boost::shared_ptr< const StateChannels > ppc(
+            new StateChannels( build_pp_channels( ppms, spms ) ) );
+    boost::shared_ptr< const StateChannels > hhc(
+            new StateChannels( build_hh_channels( hhms, spms ) ) );
+
     // Particle-hole interaction
     std::cout << "Building interaction objects." << std::endl;
     PPInteraction Gpp = build_gmatrix_from_mhj_file(
-            config_vm["interaction_file"].as<std::string>(), spms );
-    PHInteraction Gph = build_ph_interaction_from_pp( Gpp, spms );
+            config_vm["interaction_file"].as<std::string>(), spms,
+            config_vm["gmatrix_cache"].as<bool>() );
+    PHInteraction Gph = build_ph_interaction_from_pp( Gpp, spms, *sixj,
+            config_vm["num_threads"].as<int>() );
     std::cout << "Finished building interactions." << std::endl;
 
     // Build terms
     std::vector< Term > static_terms
         = build_rpa_terms( Gph, spms );
-    std::vector< Term > dynamic_terms
-        = build_dynamic_erpa_terms( Gph, Gpp, phms, ppms, hhms, sems, spms );
+    std::vector< Term > B_terms;
+    std::vector< PoleTerm > pole_terms
+        = build_dynamic_erpa_pole_terms( Gph, Gpp, phc, ppc, hhc, sems,
+                                         spms, sixj, B_terms );
 
     int tz     =  0;
     int parity =  1;
     int J      =  2;
-    double dE  =  0.001;
 
     // loop/build matricies
     const std::vector< ParticleHoleState > &ph_states =
@@ -107,23 +149,29 @@ int main( int argc, char *argv[] ) {
         << " with " << ph_states.size() << " states." << std::endl;
     // Matrix Factory
     MatrixFactory mf(
-            build_static_erpa_matrix( static_terms, dynamic_terms, ph_states ),
-            dynamic_terms, spms, ph_states, J, parity, tz );
+            build_static_erpa_matrix( static_terms, B_terms, ph_states ),
+            pole_terms, ph_states, J, parity, tz );
 
     std::cout << "Generating eigenvalue plot data." << std::endl;
 
     std::ofstream outfile(
             config_vm["output_file"].as<std::string>().c_str() );
-    for ( double E = -10; E < 10; E += dE ) {
-        std::vector< double > vals
-            = util::sorted_eigenvalues( mf.build( E ) );
-        outfile << E << " ";
-        BOOST_FOREACH( double v, vals ) { 
+    EigenvalueSamples samples = sample_eigenvalues(
+            boost::bind( plot_values, boost::cref( mf ),
+                         config_vm["num_threads"].as<int>(), _1 ),
+            config_vm["E_min"].as<double>(),
+            config_vm["E_max"].as<double>(),
+            config_vm["plot_step"].as<double>(),
+            config_vm["min_plot_step"].as<double>(),
+            config_vm["plot_tolerance"].as<double>() );
+    BOOST_FOREACH( const EigenvalueSamples::value_type &s, samples ) {
+        outfile << s.first << " ";
+        BOOST_FOREACH( double v, s.second ) {
             outfile << v << " "; }
-        outfile << std::endl;
-        E += dE; }
+        outfile << std::endl; }
     outfile << std::endl;
 
-    std::cout << "Calculation complete." << std::endl;
+    std::cout << "Calculation complete, " << samples.size()
+        << " energies evaluated." << std::endl;
 
     return 0; }
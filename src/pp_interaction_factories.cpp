@@ -6,16 +6,19 @@
 #include <boost/tuple/tuple.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
 #include <boost/numeric/ublas/symmetric.hpp>
 
 #include "io.h"
 #include "Interaction.h"
+#include "InteractionTable.h"
 #include "Modelspace.h"
 #include "pp_interaction_factories.h"
 #include "modelspace_factories.h"
 #include "angular_momentum.h"
 #include "pandya.h"
 #include "exceptions.h"
+#include "GMatrixCache.h"
 
 namespace ublas = boost::numeric::ublas;
 
@@ -23,45 +26,6 @@ namespace ublas = boost::numeric::ublas;
 // Support functions for the PP Interaction factories
 // --------------------------------------------------------------------
 
-// This has the usual format:  matricies[ tz + 1 ][ (parity+1)/2 ][ J ]
-typedef std::vector< std::vector< std::vector<
-    ublas::symmetric_matrix< double >
-> > > PPMatricies;
-
-// Format: indices[tz+1][(parity+1)/2][J]( ip1, ip2 )
-typedef std::vector< std::vector< std::vector<
-    ublas::symmetric_matrix< int >
-> > > PPIndices;
-
-// Holds the sizes of the PPMatricies during construction
-typedef std::vector< std::vector< std::vector< int > > > Indexsizes;
-
-// This function is the actual PP workhorse.
-double pp_interaction_base( const ParticleParticleState    &A,
-                            const ParticleParticleState    &B,
-                            const PPMatricies              &matricies,
-                            const PPIndices                &indices,
-                            const SingleParticleModelspace &spms ) {
-    int tz     = spms.tz[ A.ip1 ]     + spms.tz[ A.ip2 ];
-    int parity = spms.parity[ A.ip1 ] * spms.parity[ A.ip2 ];
-
-    assert( tz     == spms.tz[ B.ip1 ]     + spms.tz[ B.ip2 ] );
-    assert( parity == spms.parity[ B.ip1 ] * spms.parity[ B.ip2 ] );
-    assert( A.J    == B.J );
-
-    int phase = 1;
-    int iA = indices[ tz + 1 ][ (parity+1)/2 ][ A.J ]( A.ip1, A.ip2 );
-    int iB = indices[ tz + 1 ][ (parity+1)/2 ][ A.J ]( B.ip1, B.ip2 );
-
-    // These phases take care of antisymmetrizing the interaction.
-    if ( A.ip1 > A.ip2 )
-        phase *= std::pow( -1, spms.j[ A.ip1 ] - spms.j[ A.ip2 ] + A.J );
-    if ( B.ip1 > B.ip2 )
-        phase *= std::pow( -1, spms.j[ B.ip1 ] - spms.j[ B.ip2 ] + A.J );
-
-    return phase * matricies[ tz + 1 ][ (parity+1)/2 ][ A.J ] ( iA, iB );
-}
-
 // Returns index that corresponds to the spms index for a state
 int get_ms_index_from_line( const std::string &line,
                             const SingleParticleModelspace &spms ) {
@@ -187,27 +151,14 @@ decode_mhj_line( const std::string &line,
 }
 
 // Reads in the actual matrix elements
-PPMatricies
+boost::shared_ptr< PackedGMatrix >
 build_matricies_from_stream( std::ifstream &file,
                              const PPIndices &indices,
                              const Indexsizes &sizes,
                              const SingleParticleModelspace &spms,
                              const std::vector< int > &modelspace_map ) {
     // Initialize matricies
-    PPMatricies matricies(3); matricies.resize(3);
-    for ( int tz = -1; tz <= 1; ++tz ) {
-        matricies[ tz + 1 ].resize(2); // resize parity
-        for ( int parity = -1; parity <= 1; parity += 2 ) {
-            matricies[ tz + 1 ][ (parity + 1)/2 ].resize( // resize J
-                    indices[ tz + 1 ][ (parity + 1)/2 ].size() );
-            for ( int J = 0;
-                    J < static_cast<int>(matricies[tz+1][(parity+1)/2].size());
-                    ++J ) {
-                // add empty matricies
-                int size = sizes[ tz + 1 ][ (parity + 1)/2 ][ J ];
-                ublas::symmetric_matrix< double > m( size, size );
-                m.clear();
-                matricies[ tz + 1 ][ (parity + 1)/2 ][ J ] = m; } } }
+    boost::shared_ptr< PackedGMatrix > matricies( new PackedGMatrix( sizes ) );
 
     // loop over stream
     std::string line; // temporary used repeatedly for getline
@@ -224,19 +175,17 @@ build_matricies_from_stream( std::ifstream &file,
 
 
         // add element
-        matricies[ tz + 1 ][ (parity + 1)/2 ][ J ]( iA, iB ) = V;
+        matricies->set( tz, parity, J, iA, iB, V );
     }
 
     return matricies;
 }
 
-// --------------------------------------------------------------------
-// The actual PPInteraction factories:
-// --------------------------------------------------------------------
-
-PPInteraction
-build_gmatrix_from_mhj_file( const std::string &filename,
-                             const SingleParticleModelspace &spms ) {
+// Parses the text file.
+boost::shared_ptr< PackedGMatrix >
+read_mhj_file( const std::string &filename,
+               const PPIndices &indices, const Indexsizes &index_sizes,
+               const SingleParticleModelspace &spms ) {
     std::ifstream file( filename.c_str() );
 
     std::string line; // temporary used repeatedly for getline
@@ -246,24 +195,84 @@ build_gmatrix_from_mhj_file( const std::string &filename,
         if ( !std::getline( file, line ) )
             throw file_error();
 
-    // Construct modelspace map and PPIndices
+    // Construct modelspace map
     std::vector< int > modelspace_map
         = build_modelspace_map_from_stream( file, spms );
-    PPIndices indices;
-    Indexsizes index_sizes;
-    boost::tie( indices, index_sizes ) = build_ppindices( spms );
 
     // Skip 8 more lines
     for ( int i = 0; i < 8; ++i )
         if ( !std::getline( file, line ) )
             throw file_error();
 
-    // Construct PPMatricies
-    PPMatricies matricies
-        = build_matricies_from_stream( file, indices, index_sizes,
-                                       spms, modelspace_map );
+    // Construct the matricies
+    return build_matricies_from_stream( file, indices, index_sizes,
+                                        spms, modelspace_map );
+}
 
-    // Bind it all together
-    return boost::bind( pp_interaction_base, _1, _2,
-            matricies, indices, spms );
+// --------------------------------------------------------------------
+// The actual PPInteraction factories:
+// --------------------------------------------------------------------
+
+PPInteractionTable
+build_gmatrix_table_from_mhj_file( const std::string &filename,
+                                   const SingleParticleModelspace &spms,
+                                   bool use_cache ) {
+    PPIndices indices;
+    Indexsizes index_sizes;
+    boost::tie( indices, index_sizes ) = build_ppindices( spms );
+
+    boost::shared_ptr< const PackedGMatrix > G;
+    if ( use_cache ) {
+        std::string cache_filename = get_gmatrix_cache_filename( filename );
+        GMatrixKey key = make_gmatrix_key( filename, spms );
+        G = PackedGMatrix::map_file( cache_filename, key, index_sizes );
+        if ( !G ) {
+            boost::shared_ptr< PackedGMatrix > parsed
+                = read_mhj_file( filename, indices, index_sizes, spms );
+            // Without a writable cache the parsed matricies are used as is.
+            parsed->write_file( cache_filename, key );
+            G = parsed; } }
+    else {
+        G = read_mhj_file( filename, indices, index_sizes, spms ); }
+
+    return PPInteractionTable( G, indices, spms );
 }
+
+PPInteraction
+build_gmatrix_from_mhj_file( const std::string &filename,
+                             const SingleParticleModelspace &spms,
+                             bool use_cache ) {
+    return build_gmatrix_table_from_mhj_file( filename, spms, use_cache ); }
+
+// Every element is evaluated once, with ip1 <= ip2 so that Gpp applies no
+// phases.
+PPInteractionTable as_pp_table( const PPInteraction &Gpp,
+                                const SingleParticleModelspace &spms ) {
+    if ( const PPInteractionTable *table = Gpp.target< PPInteractionTable >() )
+        return *table;
+
+    PPIndices indices;
+    Indexsizes index_sizes;
+    boost::tie( indices, index_sizes ) = build_ppindices( spms );
+    boost::shared_ptr< PackedGMatrix > G( new PackedGMatrix( index_sizes ) );
+    for ( int tz = -1; tz <= 1; ++tz ) {
+        for ( int parity = -1; parity <= 1; parity += 2 ) {
+            for ( int J = 0;
+                    J < static_cast<int>(indices[tz+1][(parity+1)/2].size());
+                    ++J ) {
+                std::vector< ParticleParticleState > states;
+                for ( int i = 0; i < spms.size; ++i ) {
+                    for ( int j = i; j < spms.size; ++j ) {
+                        if ( indices[ tz + 1 ][ (parity+1)/2 ][ J ]( i, j )
+                                >= 0 )
+                            states.push_back(
+                                ParticleParticleState( i, j, -1, -1, J ) ); } }
+                for ( int a = 0; a < static_cast<int>(states.size()); ++a ) {
+                    for ( int b = a; b < static_cast<int>(states.size()); ++b ) {
+                        G->set( tz, parity, J, a, b,
+                                Gpp( states[a], states[b] ) ); } } } } }
+    return PPInteractionTable( G, indices, spms );
+}
+
+std::string get_gmatrix_cache_filename( const std::string &filename ) {
+    return filename + ".cache"; }
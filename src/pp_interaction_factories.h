@@ -2,12 +2,37 @@
 #define _PP_INTERACTION_FACTORIES_H_
 
 #include <string>
+#include <boost/tuple/tuple.hpp>
 
+#include "GMatrixCache.h"
 #include "Interaction.h"
+#include "InteractionTable.h"
 #include "Modelspace.h"
 
+// With use_cache the parsed matricies are kept in a binary cache next to
+// the file (see GMatrixCache.h), which is used instead of parsing while it
+// is valid.
 PPInteraction
 build_gmatrix_from_mhj_file( const std::string &filename,
-                             const SingleParticleModelspace &spms );
+                             const SingleParticleModelspace &spms,
+                             bool use_cache = false );
+
+// Same, as the concrete table the term kernels use.
+PPInteractionTable
+build_gmatrix_table_from_mhj_file( const std::string &filename,
+                                   const SingleParticleModelspace &spms,
+                                   bool use_cache = false );
+
+// Returns the table inside Gpp if there is one, and otherwise tabulates
+// Gpp.
+PPInteractionTable as_pp_table( const PPInteraction &Gpp,
+                                const SingleParticleModelspace &spms );
+
+std::string get_gmatrix_cache_filename( const std::string &filename );
+
+// Builds a lookup for finding PP matrix element indices given
+// single particle configurations, and the size of every channel.
+boost::tuple< PPIndices, Indexsizes >
+build_ppindices( const SingleParticleModelspace &spms );
 
 #endif // _PP_INTERACTION_FACTORIES_H_
@@ -0,0 +1,217 @@
+#include <vector>
+
+#include "rational_sum.h"
+
+#if defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+#define RATIONAL_SUM_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+
+using internal::RationalSumKernels;
+
+// Energies summed together by rational_sums.  Independent sums also keep
+// more divisions in flight.
+const int energy_group = 4;
+
+// --------------------------------------------------------------------
+// Plain loops
+// --------------------------------------------------------------------
+double scalar_sum( const double *R, const double *P, int n, double E ) {
+    double result = 0;
+    for ( int k = 0; k < n; ++k ) {
+        result += R[k] / ( E - P[k] ); }
+    return result; }
+
+double scalar_derivative( const double *R, const double *P, int n,
+                          double E ) {
+    double result = 0;
+    for ( int k = 0; k < n; ++k ) {
+        double d = E - P[k];
+        result -= R[k] / ( d * d ); }
+    return result; }
+
+void scalar_sums( const double *R, const double *P, int n,
+                  const double *E, int nE, double *out ) {
+    for ( int e = 0; e < nE; ++e ) {
+        out[e] += scalar_sum( R, P, n, E[e] ); } }
+
+#ifdef RATIONAL_SUM_X86
+// --------------------------------------------------------------------
+// AVX2
+// --------------------------------------------------------------------
+__attribute__(( target( "avx2" ) ))
+double avx2_reduce( __m256d v ) {
+    double lanes[4];
+    _mm256_storeu_pd( lanes, v );
+    return ( lanes[0] + lanes[1] ) + ( lanes[2] + lanes[3] ); }
+
+__attribute__(( target( "avx2" ) ))
+double avx2_sum( const double *R, const double *P, int n, double E ) {
+    __m256d e   = _mm256_set1_pd( E );
+    __m256d acc = _mm256_setzero_pd();
+    int k = 0;
+    for ( ; k + 4 <= n; k += 4 ) {
+        __m256d d = _mm256_sub_pd( e, _mm256_loadu_pd( P + k ) );
+        acc = _mm256_add_pd( acc,
+                _mm256_div_pd( _mm256_loadu_pd( R + k ), d ) ); }
+    double result = avx2_reduce( acc );
+    for ( ; k < n; ++k ) {
+        result += R[k] / ( E - P[k] ); }
+    return result; }
+
+__attribute__(( target( "avx2" ) ))
+double avx2_derivative( const double *R, const double *P, int n,
+                        double E ) {
+    __m256d e   = _mm256_set1_pd( E );
+    __m256d acc = _mm256_setzero_pd();
+    int k = 0;
+    for ( ; k + 4 <= n; k += 4 ) {
+        __m256d d = _mm256_sub_pd( e, _mm256_loadu_pd( P + k ) );
+        acc = _mm256_sub_pd( acc, _mm256_div_pd( _mm256_loadu_pd( R + k ),
+                                                 _mm256_mul_pd( d, d ) ) ); }
+    double result = avx2_reduce( acc );
+    for ( ; k < n; ++k ) {
+        double d = E - P[k];
+        result -= R[k] / ( d * d ); }
+    return result; }
+
+__attribute__(( target( "avx2" ) ))
+void avx2_sums( const double *R, const double *P, int n,
+                const double *E, int nE, double *out ) {
+    for ( int e0 = 0; e0 < nE; e0 += energy_group ) {
+        int m = nE - e0 < energy_group ? nE - e0 : energy_group;
+        __m256d e[ energy_group ], acc[ energy_group ];
+        for ( int j = 0; j < m; ++j ) {
+            e[j]   = _mm256_set1_pd( E[ e0 + j ] );
+            acc[j] = _mm256_setzero_pd(); }
+        int k = 0;
+        for ( ; k + 4 <= n; k += 4 ) {
+            __m256d r = _mm256_loadu_pd( R + k );
+            __m256d p = _mm256_loadu_pd( P + k );
+            for ( int j = 0; j < m; ++j ) {
+                acc[j] = _mm256_add_pd( acc[j],
+                        _mm256_div_pd( r, _mm256_sub_pd( e[j], p ) ) ); } }
+        for ( int j = 0; j < m; ++j ) {
+            double result = avx2_reduce( acc[j] );
+            for ( int t = k; t < n; ++t ) {
+                result += R[t] / ( E[ e0 + j ] - P[t] ); }
+            out[ e0 + j ] += result; } } }
+
+// --------------------------------------------------------------------
+// AVX-512
+// --------------------------------------------------------------------
+__attribute__(( target( "avx512f" ) ))
+double avx512_reduce( __m512d v ) {
+    double lanes[8];
+    _mm512_storeu_pd( lanes, v );
+    return ( ( lanes[0] + lanes[1] ) + ( lanes[2] + lanes[3] ) )
+         + ( ( lanes[4] + lanes[5] ) + ( lanes[6] + lanes[7] ) ); }
+
+// The tail is done with masked loads, so every element takes the same path.
+// Masked lanes divide R = 0 by 1 and add nothing.
+__attribute__(( target( "avx512f" ) ))
+double avx512_sum( const double *R, const double *P, int n, double E ) {
+    __m512d one = _mm512_set1_pd( 1 );
+    __m512d e   = _mm512_set1_pd( E );
+    __m512d acc = _mm512_setzero_pd();
+    for ( int k = 0; k < n; k += 8 ) {
+        __mmask8 mask = n - k >= 8 ? 0xff : ( 1 << ( n - k ) ) - 1;
+        __m512d r = _mm512_maskz_loadu_pd( mask, R + k );
+        __m512d d = _mm512_mask_sub_pd( one, mask, e,
+                                        _mm512_maskz_loadu_pd( mask, P + k ) );
+        acc = _mm512_add_pd( acc, _mm512_div_pd( r, d ) ); }
+    return avx512_reduce( acc ); }
+
+__attribute__(( target( "avx512f" ) ))
+double avx512_derivative( const double *R, const double *P, int n,
+                          double E ) {
+    __m512d one = _mm512_set1_pd( 1 );
+    __m512d e   = _mm512_set1_pd( E );
+    __m512d acc = _mm512_setzero_pd();
+    for ( int k = 0; k < n; k += 8 ) {
+        __mmask8 mask = n - k >= 8 ? 0xff : ( 1 << ( n - k ) ) - 1;
+        __m512d r = _mm512_maskz_loadu_pd( mask, R + k );
+        __m512d d = _mm512_mask_sub_pd( one, mask, e,
+                                        _mm512_maskz_loadu_pd( mask, P + k ) );
+        acc = _mm512_sub_pd( acc,
+                _mm512_div_pd( r, _mm512_mul_pd( d, d ) ) ); }
+    return avx512_reduce( acc ); }
+
+__attribute__(( target( "avx512f" ) ))
+void avx512_sums( const double *R, const double *P, int n,
+                  const double *E, int nE, double *out ) {
+    __m512d one = _mm512_set1_pd( 1 );
+    for ( int e0 = 0; e0 < nE; e0 += energy_group ) {
+        int m = nE - e0 < energy_group ? nE - e0 : energy_group;
+        __m512d e[ energy_group ], acc[ energy_group ];
+        for ( int j = 0; j < m; ++j ) {
+            e[j]   = _mm512_set1_pd( E[ e0 + j ] );
+            acc[j] = _mm512_setzero_pd(); }
+        for ( int k = 0; k < n; k += 8 ) {
+            __mmask8 mask = n - k >= 8 ? 0xff : ( 1 << ( n - k ) ) - 1;
+            __m512d r = _mm512_maskz_loadu_pd( mask, R + k );
+            __m512d p = _mm512_maskz_loadu_pd( mask, P + k );
+            for ( int j = 0; j < m; ++j ) {
+                acc[j] = _mm512_add_pd( acc[j], _mm512_div_pd( r,
+                            _mm512_mask_sub_pd( one, mask, e[j], p ) ) ); } }
+        for ( int j = 0; j < m; ++j ) {
+            out[ e0 + j ] += avx512_reduce( acc[j] ); } } }
+#endif // RATIONAL_SUM_X86
+
+// --------------------------------------------------------------------
+// Dispatch
+// --------------------------------------------------------------------
+RationalSumKernels make_kernels(
+        double (*sum)( const double *, const double *, int, double ),
+        double (*derivative)( const double *, const double *, int, double ),
+        void   (*sums)( const double *, const double *, int, const double *,
+                        int, double * ),
+        const char *isa ) {
+    RationalSumKernels k;
+    k.sum        = sum;
+    k.derivative = derivative;
+    k.sums       = sums;
+    k.isa        = isa;
+    return k; }
+
+const RationalSumKernels &kernels() {
+    static const RationalSumKernels k
+        = internal::supported_rational_sum_kernels().front();
+    return k; }
+
+} // end anonymous namespace
+
+namespace internal {
+
+std::vector< RationalSumKernels > supported_rational_sum_kernels() {
+    std::vector< RationalSumKernels > result;
+#ifdef RATIONAL_SUM_X86
+    __builtin_cpu_init();
+    if ( __builtin_cpu_supports( "avx512f" ) )
+        result.push_back( make_kernels( avx512_sum, avx512_derivative,
+                                        avx512_sums, "avx512" ) );
+    if ( __builtin_cpu_supports( "avx2" ) )
+        result.push_back( make_kernels( avx2_sum, avx2_derivative,
+                                        avx2_sums, "avx2" ) );
+#endif
+    result.push_back( make_kernels( scalar_sum, scalar_derivative,
+                                    scalar_sums, "scalar" ) );
+    return result; }
+
+} // end namespace internal
+
+double rational_sum( const double *R, const double *P, int n, double E ) {
+    return kernels().sum( R, P, n, E ); }
+
+double rational_sum_derivative( const double *R, const double *P, int n,
+                                double E ) {
+    return kernels().derivative( R, P, n, E ); }
+
+void rational_sums( const double *R, const double *P, int n,
+                    const double *E, int nE, double *out ) {
+    kernels().sums( R, P, n, E, nE, out ); }
+
+const char *rational_sum_isa() {
+    return kernels().isa; }
@@ -0,0 +1,45 @@
+#ifndef _RATIONAL_SUM_H_
+#define _RATIONAL_SUM_H_
+/* Sums of simple poles stored in contiguous arrays.
+ *
+ *      rational_sum( R, P, n, E ) = sum_k R[k] / ( E - P[k] )
+ *
+ * Evaluating the dynamic terms is bound by the divisions in these sums, so
+ * they are done four (AVX2) or eight (AVX-512) at a time when the processor
+ * running the program supports it.  The instruction set is picked once, at
+ * the first call, with a plain loop as the fallback.  The vector versions
+ * add in a different order, so they may differ from the plain loop in the
+ * last bits.
+ *
+ * Examples:
+ *  double value = rational_sum( &R[0], &P[0], R.size(), E );
+ *  rational_sums( &R[0], &P[0], R.size(), &E[0], E.size(), &values[0] );
+ */
+
+#include <vector>
+
+double rational_sum( const double *R, const double *P, int n, double E );
+// - sum_k R[k] / ( E - P[k] )^2
+double rational_sum_derivative( const double *R, const double *P, int n,
+                                double E );
+// out[e] += rational_sum( R, P, n, E[e] ) for every e < nE.  The arrays are
+// read once for every few energies instead of once per energy.
+void   rational_sums( const double *R, const double *P, int n,
+                      const double *E, int nE, double *out );
+
+// The instruction set in use: "avx512", "avx2" or "scalar".
+const char *rational_sum_isa();
+
+namespace internal {
+struct RationalSumKernels {
+    double (*sum)( const double *, const double *, int, double );
+    double (*derivative)( const double *, const double *, int, double );
+    void   (*sums)( const double *, const double *, int, const double *,
+                    int, double * );
+    const char *isa;
+};
+// Every version the processor supports, the one in use first.
+std::vector< RationalSumKernels > supported_rational_sum_kernels();
+} // end namespace internal
+
+#endif // _RATIONAL_SUM_H_
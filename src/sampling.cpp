@@ -0,0 +1,73 @@
+#include <cassert>
+#include <cmath>
+#include <utility>
+
+#include <boost/foreach.hpp>
+
+#include "sampling.h"
+
+namespace {
+
+typedef std::pair< double, double > span_t;
+
+// Evaluates f at E and stores the values in samples.
+void add_samples( const SampleFunction &f, const std::vector< double > &E,
+                  EigenvalueSamples &samples ) {
+    if ( E.empty() )
+        return;
+    std::vector< std::vector< double > > vals = f( E );
+    assert( vals.size() == E.size() );
+    for ( unsigned int e = 0; e < E.size(); ++e ) {
+        samples[ E[e] ].swap( vals[e] ); } }
+
+// Whether mid lies within tolerance of the line from left to right.
+bool is_linear( const std::vector< double > &left,
+                const std::vector< double > &mid,
+                const std::vector< double > &right, double tolerance ) {
+    if ( left.size() != mid.size() || right.size() != mid.size() )
+        return false;
+    for ( unsigned int k = 0; k < mid.size(); ++k ) {
+        if ( !( std::abs( mid[k] - 0.5 * ( left[k] + right[k] ) )
+                    <= tolerance ) )
+            return false; }
+    return true; }
+
+} // end anonymous namespace
+
+EigenvalueSamples sample_eigenvalues( const SampleFunction &f,
+                                      double Emin, double Emax, double step,
+                                      double min_step, double tolerance ) {
+    assert( Emin < Emax );
+    assert( step > 0 );
+    EigenvalueSamples samples;
+
+    // Coarse grid
+    int num_spans = std::max( 1, static_cast<int>(
+                std::ceil( ( Emax - Emin ) / step ) ) );
+    std::vector< double > E;
+    for ( int i = 0; i <= num_spans; ++i ) {
+        E.push_back( Emin + ( Emax - Emin ) * i / num_spans ); }
+    add_samples( f, E, samples );
+    std::vector< span_t > spans;
+    for ( int i = 0; i < num_spans; ++i ) {
+        spans.push_back( span_t( E[i], E[i+1] ) ); }
+
+    // Refinement, one round of midpoints at a time
+    while ( !spans.empty() ) {
+        std::vector< span_t > wide;
+        E.clear();
+        BOOST_FOREACH( const span_t &s, spans ) {
+            if ( s.second - s.first <= min_step )
+                continue;
+            wide.push_back( s );
+            E.push_back( 0.5 * ( s.first + s.second ) ); }
+        add_samples( f, E, samples );
+
+        spans.clear();
+        for ( unsigned int n = 0; n < wide.size(); ++n ) {
+            if ( is_linear( samples[ wide[n].first ], samples[ E[n] ],
+                            samples[ wide[n].second ], tolerance ) )
+                continue;
+            spans.push_back( span_t( wide[n].first, E[n] ) );
+            spans.push_back( span_t( E[n], wide[n].second ) ); } }
+    return samples; }
@@ -0,0 +1,36 @@
+#ifndef _SAMPLING_H_
+#define _SAMPLING_H_
+/* Adaptive sampling of the eigenvalues of a channel as functions of E.
+ *
+ * A coarse grid of spacing step covers [ Emin, Emax ].  Every interval is
+ * then split at its midpoint for as long as the values there are further
+ * than tolerance from the straight line between its ends, and the interval
+ * is wider than min_step.  Points end up crowded around asymptotes and
+ * eigenvalue crossings, and spread out where the eigenvalues are smooth.
+ * A midpoint with a different number of values also splits its interval.
+ * All the midpoints of a round are evaluated in one call.
+ *
+ * Example:
+ *  // values( E )[e] are the sorted eigenvalues at E[e]
+ *  EigenvalueSamples samples
+ *      = sample_eigenvalues( values, -10, 10, 0.05, 0.002, 0.01 );
+ *  BOOST_FOREACH( const EigenvalueSamples::value_type &s, samples ) { ... }
+ */
+
+#include <map>
+#include <vector>
+
+#include <boost/function.hpp>
+
+// The values at every energy given.
+typedef boost::function< std::vector< std::vector< double > >
+                         ( const std::vector< double > & ) > SampleFunction;
+
+// Energy -> values, in order of energy.
+typedef std::map< double, std::vector< double > > EigenvalueSamples;
+
+EigenvalueSamples sample_eigenvalues( const SampleFunction &f,
+                                      double Emin, double Emax, double step,
+                                      double min_step, double tolerance );
+
+#endif // _SAMPLING_H_
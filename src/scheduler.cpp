@@ -0,0 +1,162 @@
+#include <vector>
+#include <algorithm>
+
+#include <boost/bind.hpp>
+#include <boost/exception_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+
+#include "scheduler.h"
+
+namespace internal {
+
+bool more_expensive( const std::vector< double > &costs, int a, int b ) {
+    return costs[a] > costs[b]; }
+
+// Shared state for the workers.
+class ChannelQueue {
+    public:
+        ChannelQueue( const std::vector< double > &costs,
+                      const ChannelSolver &nsolve,
+                      const ChannelWriter &nwrite )
+            : solve( nsolve ), write( nwrite ), next( 0 ), next_write( 0 ),
+              results( costs.size() ), done( costs.size(), false ) {
+            for ( int i = 0; i < static_cast<int>(costs.size()); ++i ) {
+                order.push_back( i ); }
+            std::stable_sort( order.begin(), order.end(),
+                    boost::bind( more_expensive, boost::cref(costs),
+                        _1, _2 ) ); }
+
+        void work() {
+            int channel;
+            while ( pop( channel ) ) {
+                try {
+                    finish( channel, solve( channel ) ); }
+                catch ( ... ) {
+                    boost::lock_guard< boost::mutex > lock( mutex );
+                    if ( !error )
+                        error = boost::current_exception(); } } }
+
+        void rethrow() const {
+            if ( error )
+                boost::rethrow_exception( error ); }
+
+    private:
+        bool pop( int &channel ) {
+            boost::lock_guard< boost::mutex > lock( mutex );
+            if ( error || next == order.size() )
+                return false;
+            channel = order[ next++ ];
+            return true; }
+
+        // Stores the result and writes out every finished channel that is
+        // next in line.
+        void finish( int channel, const std::vector< double > &vals ) {
+            boost::lock_guard< boost::mutex > lock( mutex );
+            results[ channel ] = vals;
+            done[ channel ]    = true;
+            while ( next_write < done.size() && done[ next_write ] ) {
+                write( next_write, results[ next_write ] );
+                results[ next_write ].clear();
+                ++next_write; } }
+
+        const ChannelSolver &solve;
+        const ChannelWriter &write;
+
+        boost::mutex                         mutex;
+        std::vector< int >                   order;
+        std::size_t                          next;
+        std::size_t                          next_write;
+        std::vector< std::vector< double > > results;
+        std::vector< bool >                  done;
+        boost::exception_ptr                 error;
+};
+
+} // end namespace internal
+
+void run_channels( const std::vector< double > &costs,
+                   const ChannelSolver &solve,
+                   const ChannelWriter &write,
+                   int num_threads ) {
+    internal::ChannelQueue queue( costs, solve, write );
+    if ( num_threads < 2 ) {
+        queue.work(); }
+    else {
+        boost::thread_group threads;
+        for ( int t = 0; t < num_threads; ++t ) {
+            threads.create_thread(
+                    boost::bind( &internal::ChannelQueue::work, &queue ) ); }
+        threads.join_all(); }
+    queue.rethrow(); }
+
+double estimate_channel_cost( int num_ph_states, int num_2p2h_states ) {
+    double dimension = 2.0 * num_ph_states;
+    return dimension * dimension * dimension * ( num_2p2h_states + 1.0 ); }
+
+// --------------------------------------------------------------------
+// TaskPool
+// --------------------------------------------------------------------
+namespace internal {
+
+// current_worker points into the stack of work, so nothing is deleted.
+void keep_worker( int * ) { }
+
+} // end namespace internal
+
+TaskPool::TaskPool( int nnum_threads )
+    : num_threads( std::max( 1, nnum_threads ) ), queues( num_threads ),
+      pending( 0 ), current_worker( internal::keep_worker ) { }
+
+void TaskPool::submit( const Task &task ) {
+    int worker = current_worker.get() ? *current_worker : 0;
+    boost::lock_guard< boost::mutex > lock( mutex );
+    queues[ worker ].push_back( task );
+    ++pending;
+    changed.notify_one(); }
+
+// Takes the newest task of the worker's own queue, or else the oldest task
+// of another queue.  Waits while other workers may still submit tasks.
+bool TaskPool::pop( int worker, Task &task ) {
+    boost::unique_lock< boost::mutex > lock( mutex );
+    while ( true ) {
+        if ( error || 0 == pending )
+            return false;
+        if ( !queues[ worker ].empty() ) {
+            task = queues[ worker ].back();
+            queues[ worker ].pop_back();
+            return true; }
+        for ( int i = 1; i < num_threads; ++i ) {
+            std::deque< Task > &victim = queues[ ( worker + i ) % num_threads ];
+            if ( !victim.empty() ) {
+                task = victim.front();
+                victim.pop_front();
+                return true; } }
+        changed.wait( lock ); } }
+
+void TaskPool::work( int worker ) {
+    current_worker.reset( &worker );
+    Task task;
+    while ( pop( worker, task ) ) {
+        try {
+            task(); }
+        catch ( ... ) {
+            boost::lock_guard< boost::mutex > lock( mutex );
+            if ( !error )
+                error = boost::current_exception(); }
+        boost::lock_guard< boost::mutex > lock( mutex );
+        if ( 0 == --pending || error )
+            changed.notify_all(); }
+    current_worker.reset(); }
+
+void TaskPool::run() {
+    if ( num_threads < 2 ) {
+        work( 0 ); }
+    else {
+        boost::thread_group threads;
+        for ( int t = 0; t < num_threads; ++t ) {
+            threads.create_thread(
+                    boost::bind( &TaskPool::work, this, t ) ); }
+        threads.join_all(); }
+    if ( error )
+        boost::rethrow_exception( error ); }
@@ -0,0 +1,78 @@
+#ifndef _SCHEDULER_H_
+#define _SCHEDULER_H_
+/* Runs independent parts of a calculation on a pool of threads.
+ *
+ * run_channels handles a fixed list of channels:
+ * Channels are identified by their index 0 .. costs.size() - 1.  The most
+ * expensive channels (by the estimated costs) are started first, and the
+ * results are handed to write in index order, as soon as every earlier
+ * channel is done.  write is never called concurrently.
+ *
+ * Example:
+ *  run_channels( costs, boost::bind( solve, _1, ... ),
+ *                boost::bind( write, boost::ref( outfile ), _1, _2 ),
+ *                num_threads );
+ *
+ * TaskPool handles work that is split up while it runs.  Each worker keeps
+ * its own queue of tasks; a task submitted from a worker goes to the back
+ * of that worker's queue, and an idle worker steals from the front of the
+ * queue of another one.
+ *  TaskPool pool( num_threads );
+ *  pool.submit( boost::bind( task, boost::ref( pool ), ... ) );
+ *  pool.run();
+ */
+
+#include <vector>
+#include <deque>
+
+#include <boost/function.hpp>
+#include <boost/exception_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/tss.hpp>
+
+typedef boost::function< std::vector< double > ( int ) > ChannelSolver;
+typedef boost::function< void ( int, const std::vector< double > & ) >
+    ChannelWriter;
+
+// The first exception thrown by solve is rethrown here, after the running
+// channels finish.  num_threads < 2 runs in the calling thread.
+void run_channels( const std::vector< double > &costs,
+                   const ChannelSolver &solve,
+                   const ChannelWriter &write,
+                   int num_threads );
+
+// Estimated cost of solving a channel: every probe of the search is a
+// dense diagonalization, and the number of probes follows the asymptotes.
+// The poles of a channel are only known once its terms are tabulated, so
+// its 2p2h states (count_2p2h_states) stand in for them.
+double estimate_channel_cost( int num_ph_states, int num_2p2h_states );
+
+class TaskPool {
+    public:
+        typedef boost::function< void () > Task;
+
+        explicit TaskPool( int nnum_threads );
+
+        // Safe to call from inside a running task.
+        void submit( const Task &task );
+
+        // Runs until every submitted task (and every task they submit) is
+        // done.  The first exception thrown by a task stops the pool and is
+        // rethrown here.  num_threads < 2 runs in the calling thread.  After
+        // a run without exception the pool takes new tasks for another run.
+        void run();
+    private:
+        void work( int worker );
+        bool pop( int worker, Task &task );
+
+        int                               num_threads;
+        std::vector< std::deque< Task > > queues;
+        int                               pending;
+        boost::mutex                      mutex;
+        boost::condition_variable         changed;
+        boost::thread_specific_ptr< int > current_worker;
+        boost::exception_ptr              error;
+};
+
+#endif // _SCHEDULER_H_
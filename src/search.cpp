@@ -2,17 +2,23 @@
 #include <cassert>
 #include <vector>
 #include <algorithm>
+#include <map>
+#include <limits>
 
 #include <boost/bind.hpp>
 #include <boost/numeric/conversion/cast.hpp>
 #include <boost/tuple/tuple.hpp>
 #include <boost/numeric/interval/io.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
 
 #include "find_root.h"
 #include "determinant.h"
 #include "linalg.h"
 #include "intervals.h"
 #include "MatrixFactory.h"
+#include "scheduler.h"
+#include "search.h"
 
 // Returns the number of elements (above, below) E in vals.
 boost::tuple< int, int >
@@ -33,91 +39,301 @@ int get_num_solutions( const std::vector< double > &left_vals,  double left,
     boost::tuple< int, int > ab_left  = split_values( left_vals,  left );
     boost::tuple< int, int > ab_right = split_values( right_vals, right );
 
-    int     num_solutions =  ab_right.get<1>() - ab_left.get<1>();
-    assert( num_solutions == ab_left.get<0>()  - ab_right.get<0>() );
+    return get_num_solutions( ab_left, ab_right ); }
+
+int get_num_solutions( const boost::tuple< int, int > &left_count,
+                       const boost::tuple< int, int > &right_count ) {
+    int     num_solutions =  right_count.get<1>() - left_count.get<1>();
+    assert( num_solutions == left_count.get<0>()  - right_count.get<0>() );
 
     return num_solutions; }
 
-// Root finding functions
-double base_root_function( double E, const MatrixFactory &mf, int index ) {
-    std::vector< double > vals = util::sorted_eigenvalues( mf.build(E) );
-    return vals[index] - E; }
+// The problem evaluated at E.  When the inertia gives the eigenvalue count
+// the eigenvalues themselves are not computed and vals is left empty.
+struct Probe {
+    boost::tuple< int, int > count;
+    std::vector< double >    vals;
+};
+
+// Returns false when the eigenvalues at E are not in the cache.
+bool find_probe( const MatrixFactory &mf, double E, Probe &result ) {
+    if ( !mf.eigenvalue_cache().find( E, result.vals ) )
+        return false;
+    result.count = split_values( result.vals, E );
+    return true; }
+
+// The problem evaluated at E, where m is mf.build( E ).  The inertia count
+// is only tried when mf has the structure for it.
+Probe probe( const MatrixFactory &mf, double E, const util::matrix_t &m ) {
+    Probe result;
+    if ( !mf.has_rpa_structure() ||
+         !util::rpa_count_values( m, E, result.count ) ) {
+        result.vals  = util::sorted_eigenvalues( m );
+        result.count = split_values( result.vals, E );
+        mf.eigenvalue_cache().insert( E, result.vals ); }
+    return result; }
+
+// Eigenvalues found earlier at E are reused.
+Probe probe( const MatrixFactory &mf, double E ) {
+    Probe result;
+    if ( find_probe( mf, E, result ) )
+        return result;
+    return probe( mf, E, mf.build( E ) ); }
+
+// Returns the number of eigenvalues (above, below) E for the problem
+// evaluated at E.
+boost::tuple< int, int > count_values( const MatrixFactory &mf, double E ) {
+    return probe( mf, E ).count; }
+
+// Root finding function and its derivative.  The eigenvalue's slope comes from
+// d M / d E, and is NaN (forcing a bisection step) when the eigenvalue is
+// complex.
+boost::tuple< double, double >
+slope_root_function( double E, const MatrixFactory &mf, int index ) {
+    double value = std::numeric_limits< double >::quiet_NaN();
+    double slope = value;
+    if ( !util::sorted_eigenvalue_slope( mf.build( E ),
+                mf.build_derivative( E ), index, value, slope ) )
+        slope = std::numeric_limits< double >::quiet_NaN();
+    return boost::make_tuple( value - E, slope - 1 ); }
 
 double root_find_solution( const MatrixFactory &mf, const interval_t &region,
-                           const std::vector< double > lower_vals,
-                           const std::vector< double > upper_vals,
+                           const Probe &lower, const Probe &upper,
                            double epsilon ) {
+    const std::vector< double > &lower_vals = lower.vals.empty()
+        ? mf.sorted_eigenvalues( region.lower() ) : lower.vals;
+    const std::vector< double > &upper_vals = upper.vals.empty()
+        ? mf.sorted_eigenvalues( region.upper() ) : upper.vals;
     int index = std::upper_bound( lower_vals.begin(), lower_vals.end(),
             region.lower() ) - lower_vals.begin();
     double flower = lower_vals[index] - region.lower();
     double fupper = upper_vals[index] - region.upper();
-    return util::false_position(
-            boost::bind( base_root_function, _1, boost::cref(mf),
+    return util::safe_newton(
+            boost::bind( slope_root_function, _1, boost::cref(mf),
                 index ),
             region.lower(), region.upper(), flower, fupper, epsilon ); }
 
+// Takes a root found with a surrogate (MatrixFactory::surrogate) to the
+// exact problem:  Newton steps on the exact eigenvalue closest to root.
+// When they do not settle inside region, the root is found again with the
+// exact problem alone.
+double verify_root( const MatrixFactory &exact, const interval_t &region,
+                    double root, double epsilon ) {
+    std::vector< double > vals = exact.sorted_eigenvalues( root );
+    int index = 0;
+    for ( int n = 1; n < static_cast<int>(vals.size()); ++n ) {
+        if ( std::abs( vals[n] - root ) < std::abs( vals[index] - root ) )
+            index = n; }
+
+    for ( int step = 0; step < 3; ++step ) {
+        double f, df;
+        boost::tie( f, df ) = slope_root_function( root, exact, index );
+        double next = root - f / df;
+        if ( !boost::numeric::in( next, region ) )
+            break;
+        bool converged = std::abs( next - root ) < epsilon;
+        root = next;
+        if ( converged )
+            return root; }
+    return root_find_solution( exact, region, probe( exact, region.lower() ),
+                               probe( exact, region.upper() ), epsilon ); }
+
+// Whether mf.build( E ) has an eigenvalue within the precision of the
+// search of E, imaginary part included.  The eigenvalue counts also change
+// where the real part of a complex pair crosses E, which is not a solution.
+bool is_real_solution( const MatrixFactory &mf, double E, double epsilon ) {
+    double tolerance = 10 * epsilon * ( 1 + std::abs( E ) );
+    BOOST_FOREACH( const util::complex_t &v,
+                   util::rpa_eigenvalues( mf.build( E ) ) ) {
+        if ( std::abs( v - E ) < tolerance )
+            return true; }
+    return false; }
+
+// Roots found by the tasks of a search, keyed by the asymptote region and
+// the lower end of the part of it they were found in.  The parts never
+// overlap, so reading the map in order gives the roots in the same order as
+// a serial search.
+class RegionResults {
+    public:
+        void add( int slot, const interval_t &region,
+                  const std::vector< double > &roots ) {
+            boost::lock_guard< boost::mutex > lock( mutex );
+            results[ key_t( slot, region.lower() ) ] = roots; }
+
+        std::vector< double > collect() const {
+            std::vector< double > roots;
+            typedef std::map< key_t, std::vector< double > >::value_type
+                entry_t;
+            BOOST_FOREACH( const entry_t &e, results ) {
+                roots.insert( roots.end(), e.second.begin(), e.second.end() ); }
+            return roots; }
+    private:
+        typedef std::pair< int, double > key_t;
+        boost::mutex                              mutex;
+        std::map< key_t, std::vector< double > >  results;
+};
+
 // This is the main search algorithm for the (D)ERPA.
-std::vector< double >
-solve_region( const MatrixFactory &mf, const interval_t &region,
-              const std::vector< double > lower_vals,
-              const std::vector< double > upper_vals,
-              double epsilon ) {
+// Only the eigenvalue counts are needed to bracket solutions, the
+// eigenvalues themselves are needed when finding a single root.
+// Regions with more than one solution are split in two, and both halves
+// are handed back to the pool.
+// mf is probed; when it is a surrogate of exact, the roots are verified
+// with exact.  Roots that are not real eigenvalues of exact are dropped.
+// The tasks keep a copy of mf, which shares its tables.
+void solve_region( TaskPool &pool, RegionResults &results, int slot,
+                   const MatrixFactory &mf, const MatrixFactory &exact,
+                   const interval_t &region,
+                   const Probe &lower, const Probe &upper,
+                   double epsilon ) {
     // Determine # solutions
-    int num_solutions = get_num_solutions( lower_vals, region.lower(),
-                                           upper_vals, region.upper() );
+    int num_solutions = get_num_solutions( lower.count, upper.count );
     // If no solutions, return empty.
     if ( 0 == num_solutions ) {
-        return std::vector< double >(); }
+        return; }
 
     // If the interval has no width, but has solutions, return the value.
     if ( std::abs( region.upper() - region.lower() ) < epsilon ) {
-        return std::vector< double >( 1, region.lower() ); }
+        if ( is_real_solution( exact, region.lower(), epsilon ) )
+            results.add( slot, region,
+                         std::vector< double >( 1, region.lower() ) );
+        return; }
 
     // If 1 solution, root_find.
     if ( 1 == num_solutions ) {
-        std::vector< double > temp( 1,
-                root_find_solution( mf, region, lower_vals, upper_vals,
-                    epsilon ) );
-        return temp; }
+        double root = root_find_solution( mf, region, lower, upper, epsilon );
+        if ( mf.is_surrogate() )
+            root = verify_root( exact, region, root, epsilon );
+        if ( is_real_solution( exact, root, epsilon ) )
+            results.add( slot, region, std::vector< double >( 1, root ) );
+        return; }
 
     // If > 1 solution, sub-divide region.
     double center = boost::numeric::median( region );
-    std::vector< double > center_vals
-        = util::sorted_eigenvalues( mf.build( center ) );
-    std::vector< double > solutions
-        = solve_region( mf, interval_t( region.lower(), center ),
-                        lower_vals, center_vals, epsilon );
-    { std::vector< double > upper_solutions
-        = solve_region( mf, interval_t( center, region.upper() ),
-                        center_vals, upper_vals, epsilon );
-        solutions.insert( solutions.end(), upper_solutions.begin(),
-                upper_solutions.end() ); }
-    return solutions; }
-
-// Finds all (D)ERPA solutions up to the next asymptote above Emax.
-// epsilon defines how far away from asymptotes to evaluate the problem.
+    Probe center_probe = probe( mf, center );
+    pool.submit( boost::bind( solve_region, boost::ref( pool ),
+                boost::ref( results ), slot, mf, boost::cref( exact ),
+                interval_t( center, region.upper() ),
+                center_probe, upper, epsilon ) );
+    pool.submit( boost::bind( solve_region, boost::ref( pool ),
+                boost::ref( results ), slot, mf, boost::cref( exact ),
+                interval_t( region.lower(), center ),
+                lower, center_probe, epsilon ) ); }
+
+// Most regions between asymptotes probed by one task.  The matrices at
+// their ends are built together (see MatrixFactory::build), so a group
+// shares the passes over the pole tables.
+const int max_region_group = 8;
+
+// Evaluates the problem at both ends of each of a group of regions between
+// asymptotes before solving them.  Region n is slot first_slot + n.  With
+// a surrogate_degree above 0 each region is searched with a surrogate.
+void solve_asymptote_regions( TaskPool &pool, RegionResults &results,
+                              int first_slot, const MatrixFactory &mf,
+                              const std::vector< interval_t > &regions,
+                              double epsilon, int surrogate_degree ) {
+    if ( surrogate_degree > 0 ) {
+        for ( unsigned int n = 0; n < regions.size(); ++n ) {
+            MatrixFactory fit = mf.surrogate( regions[n].lower(),
+                    regions[n].upper(), surrogate_degree );
+            solve_region( pool, results, first_slot + n, fit, mf, regions[n],
+                          probe( fit, regions[n].lower() ),
+                          probe( fit, regions[n].upper() ), epsilon ); }
+        return; }
+
+    // Count eigenvalues at upper and lower limits.
+    std::vector< Probe >  probes( 2 * regions.size() );
+    std::vector< int >    missing;
+    std::vector< double > ends;
+    for ( unsigned int n = 0; n < regions.size(); ++n ) {
+        double limits[] = { regions[n].lower(), regions[n].upper() };
+        for ( int side = 0; side < 2; ++side ) {
+            if ( find_probe( mf, limits[side], probes[ 2 * n + side ] ) )
+                continue;
+            missing.push_back( 2 * n + side );
+            ends.push_back( limits[side] ); } }
+    {   std::vector< util::matrix_t > matrices;
+        mf.build( ends, matrices );
+        for ( unsigned int m = 0; m < missing.size(); ++m ) {
+            probes[ missing[m] ] = probe( mf, ends[m], matrices[m] ); } }
+    // Solve inside regions
+    for ( unsigned int n = 0; n < regions.size(); ++n ) {
+        solve_region( pool, results, first_slot + n, mf, mf, regions[n],
+                      probes[ 2 * n ], probes[ 2 * n + 1 ], epsilon ); } }
+
+// Finds all (D)ERPA solutions up to the next asymptote above Emax, or up to
+// Emax when there is none.  epsilon defines how far away from asymptotes to
+// evaluate the problem.
 std::vector< double >
 solve_derpa_eigenvalues( double Emax,
                          const MatrixFactory &mf,
                          const std::vector< double > &asymptotes,
-                         double epsilon ) {
+                         double epsilon,
+                         int num_threads,
+                         int surrogate_degree ) {
+    std::vector< interval_t > regions;
     double lower = 0;
-    std::vector< double > results;
     for ( int a = 0; a < boost::numeric_cast<int>(asymptotes.size()); ++a ) {
-        interval_t region( lower + epsilon, asymptotes[a] - epsilon );
         // All done.
         if ( lower > Emax )
             break;
-        // Evaluate eigenvalues at upper and lower limits.
-        std::vector< double > lower_vals
-            = util::sorted_eigenvalues( mf.build( region.lower() ) );
-        std::vector< double > upper_vals
-            = util::sorted_eigenvalues( mf.build( region.upper() ) );
-        // Solve inside region
-        std::vector< double > region_results = solve_region( mf, region,
-                lower_vals, upper_vals, epsilon );
-        results.insert( results.end(), region_results.begin(),
-                                       region_results.end() );
+        // Nothing to search between asymptotes closer than 2 epsilon.
+        if ( asymptotes[a] - lower > 2 * epsilon )
+            regions.push_back( interval_t( lower + epsilon,
+                                           asymptotes[a] - epsilon ) );
         lower = asymptotes[a]; }
-    return results;
+    // Past the last asymptote (or with none at all) stop at Emax.
+    if ( lower + epsilon < Emax )
+        regions.push_back( interval_t( lower + epsilon, Emax ) );
+
+    // Small enough groups to give every thread one.
+    int num_regions = regions.size();
+    int workers     = std::max( 1, num_threads );
+    int group = std::max( 1, std::min( max_region_group,
+                ( num_regions + workers - 1 ) / workers ) );
+    TaskPool      pool( num_threads );
+    RegionResults results;
+    for ( int first = 0; first < num_regions; first += group ) {
+        int last = std::min( first + group, num_regions );
+        pool.submit( boost::bind( solve_asymptote_regions, boost::ref( pool ),
+                    boost::ref( results ), first, boost::cref( mf ),
+                    std::vector< interval_t >( regions.begin() + first,
+                                               regions.begin() + last ),
+                    epsilon, surrogate_degree ) ); }
+    pool.run();
+    return results.collect();
 }
+
+// Real eigenvalues of the linearized problem, in the regions the search
+// would cover:  from 0 up to the first asymptote above Emax (or Emax, when
+// there is none), and further than epsilon from any asymptote.
+std::vector< double >
+solve_linearized_eigenvalues( double Emax,
+                              const MatrixFactory &mf,
+                              const std::vector< double > &asymptotes,
+                              double epsilon ) {
+    std::vector< double > sorted_asymptotes( asymptotes );
+    std::sort( sorted_asymptotes.begin(), sorted_asymptotes.end() );
+    std::vector< double >::const_iterator top = std::upper_bound(
+            sorted_asymptotes.begin(), sorted_asymptotes.end(), Emax );
+    double upper = sorted_asymptotes.end() == top ? Emax + epsilon : *top;
+
+    util::cvector_t vals = util::eigenvalues( mf.build_linearized() );
+    std::vector< double > results;
+    BOOST_FOREACH( const util::complex_t &v, vals ) {
+        double E = v.real();
+        if ( std::abs( v.imag() ) > 1e-8 * ( 1 + std::abs( E ) ) )
+            continue;
+        if ( E < epsilon || E > upper - epsilon )
+            continue;
+        // Distance to the closest asymptote
+        std::vector< double >::const_iterator next = std::lower_bound(
+                sorted_asymptotes.begin(), sorted_asymptotes.end(), E );
+        if ( sorted_asymptotes.end() != next && *next - E < epsilon )
+            continue;
+        if ( sorted_asymptotes.begin() != next && E - *(next - 1) < epsilon )
+            continue;
+        results.push_back( E ); }
+    std::sort( results.begin(), results.end() );
+    return results; }
+
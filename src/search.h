@@ -10,10 +10,40 @@ split_values( const std::vector< double > &sorted_vals, double E );
 
 int get_num_solutions( const std::vector< double > &left_vals,  double left,
                        const std::vector< double > &right_vals, double right );
+int get_num_solutions( const boost::tuple< int, int > &left_count,
+                       const boost::tuple< int, int > &right_count );
 
+boost::tuple< int, int > count_values( const MatrixFactory &mf, double E );
+
+// The regions between asymptotes, and the halves they are split into, are
+// solved as separate tasks on num_threads threads.  The result does not
+// depend on num_threads.
+// With surrogate_degree above 0 every region is bracketed and solved with
+// MatrixFactory::surrogate of that degree, and each root is then checked,
+// and refined, with mf itself.  mf must have every dynamic term tabulated.
+// A root is only kept when mf.build( E ) has an eigenvalue within
+// 10 epsilon ( 1 + |E| ) of it, which drops the real parts of complex pairs
+// crossing E.  A region is bracketed by the net change of the eigenvalue
+// counts at its ends, so a pair of roots where eigenvalues cross E in opposite directions (as just
+// below a pole) is missed.
 std::vector< double >
 solve_derpa_eigenvalues( double Emax,
                          const MatrixFactory &mf,
                          const std::vector< double > &asymptotes,
-                         double epsilon = 0.0001 );
+                         double epsilon = 0.0001,
+                         int num_threads = 1,
+                         int surrogate_degree = 0 );
+
+// The real eigenvalues of the linearized problem
+// (MatrixFactory::build_linearized) in the window solve_derpa_eigenvalues
+// searches.  Each is a real eigenvalue of mf.build( E ); they include every
+// root the search returns, and the pairs it misses.
+// This is one dense solve (geev) of the whole linearized matrix, not a
+// sparse one:  O(size^3) time and O(size^2) memory, which is why erpa only
+// uses it for channels up to linearized_max_size.
+std::vector< double >
+solve_linearized_eigenvalues( double Emax,
+                              const MatrixFactory &mf,
+                              const std::vector< double > &asymptotes,
+                              double epsilon = 0.0001 );
 #endif // _SEARCH_H_
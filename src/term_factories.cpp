@@ -10,6 +10,7 @@
 #include "terms/screening.h"
 #include "terms/ladder.h"
 #include "terms/self_energy.h"
+#include "terms/dynamic_erpa.h"
 
 std::vector< Term > build_rpa_terms( const PHInteraction &Gph,
                                      const SingleParticleModelspace &spms ) {
@@ -24,37 +25,89 @@ std::vector< Term > build_rpa_terms( const PHInteraction &Gph,
 std::vector< Term > build_dynamic_erpa_terms(
                                     const PHInteraction &Gph,
                                     const PPInteraction &Gpp,
-                                    const ParticleHoleModelspace     &phms,
-                                    const ParticleParticleModelspace &ppms,
-                                    const ParticleParticleModelspace &hhms,
+                                    boost::shared_ptr< const StateChannels >
+                                                                      phc,
+                                    boost::shared_ptr< const StateChannels >
+                                                                      ppc,
+                                    boost::shared_ptr< const StateChannels >
+                                                                      hhc,
                                     const SEModelspace               &sems,
-                                    const SingleParticleModelspace   &spms ) {
+                                    const SingleParticleModelspace   &spms,
+                                    boost::shared_ptr< const Wigner6jTable >
+                                                                      sixj ) {
     std::vector< Term > tvec;
 
-    tvec.push_back( terms::make_screening( Gph, phms, spms ) );
-    tvec.push_back( terms::make_ladder( Gpp, ppms, hhms, spms ) );
-    tvec.push_back( terms::make_self_energy( Gpp, ppms, hhms, sems, spms ) );
+    tvec.push_back( terms::make_screening( Gph, phc, spms, sixj ) );
+    tvec.push_back( terms::make_ladder( Gpp, ppc, hhc, spms, sixj ) );
+    tvec.push_back( terms::make_self_energy( Gpp, ppc, hhc, sems, spms ) );
     return tvec;
     // Dummy code
     std::vector< Term > fvec;
-    fvec.push_back( terms::make_screening( Gph, phms, spms ) );
-    fvec.push_back( terms::make_ladder( Gpp, ppms, hhms, spms ) );
-    fvec.push_back( terms::make_self_energy( Gpp, ppms, hhms, sems, spms ) );
+    fvec.push_back( terms::make_screening( Gph, phc, spms, sixj ) );
+    fvec.push_back( terms::make_ladder( Gpp, ppc, hhc, spms, sixj ) );
+    fvec.push_back( terms::make_self_energy( Gpp, ppc, hhc, sems, spms ) );
+}
+
+std::vector< PoleTerm > build_dynamic_erpa_pole_terms(
+                                    const PHInteraction &Gph,
+                                    const PPInteraction &Gpp,
+                                    boost::shared_ptr< const StateChannels >
+                                                                      phc,
+                                    boost::shared_ptr< const StateChannels >
+                                                                      ppc,
+                                    boost::shared_ptr< const StateChannels >
+                                                                      hhc,
+                                    const SEModelspace               &sems,
+                                    const SingleParticleModelspace   &spms,
+                                    boost::shared_ptr< const Wigner6jTable >
+                                                                      sixj,
+                                    std::vector< Term > &B_terms ) {
+    std::vector< PoleTerm > tvec;
+
+    boost::shared_ptr< const terms::DynamicERPAData > data
+        = terms::make_dynamic_erpa_data( Gph, Gpp, phc, ppc, hhc, sems,
+                                         spms, sixj );
+    tvec.push_back( terms::make_dynamic_erpa_poles( data ) );
+    B_terms.push_back( terms::make_dynamic_erpa_B( data ) );
+    return tvec;
+}
+
+std::vector< PoleTerm > build_dynamic_erpa_pole_terms(
+                                    const PHInteraction &Gph,
+                                    const PPInteraction &Gpp,
+                                    boost::shared_ptr< const StateChannels >
+                                                                      phc,
+                                    boost::shared_ptr< const StateChannels >
+                                                                      ppc,
+                                    boost::shared_ptr< const StateChannels >
+                                                                      hhc,
+                                    const SEModelspace               &sems,
+                                    const SingleParticleModelspace   &spms,
+                                    boost::shared_ptr< const Wigner6jTable >
+                                                                      sixj ) {
+    std::vector< Term > B_terms;
+    return build_dynamic_erpa_pole_terms( Gph, Gpp, phc, ppc, hhc, sems,
+                                          spms, sixj, B_terms );
 }
 
 std::vector< Term > build_dynamic_derpa_terms(
                                     const PHInteraction &Gph,
                                     const PPInteraction &Gpp,
-                                    const ParticleHoleModelspace     &phms,
-                                    const ParticleParticleModelspace &ppms,
-                                    const ParticleParticleModelspace &hhms,
+                                    boost::shared_ptr< const StateChannels >
+                                                                      phc,
+                                    boost::shared_ptr< const StateChannels >
+                                                                      ppc,
+                                    boost::shared_ptr< const StateChannels >
+                                                                      hhc,
 //                                    const PPFromSPModelspace         &ppspms,
 //                                    const PPFromSPModelspace         &hhspms,
-                                    const SingleParticleModelspace   &spms ) {
+                                    const SingleParticleModelspace   &spms,
+                                    boost::shared_ptr< const Wigner6jTable >
+                                                                      sixj ) {
     std::vector< Term > tvec;
 
-    tvec.push_back( terms::make_screening( Gph, phms, spms ) );
-    tvec.push_back( terms::make_ladder( Gpp, ppms, hhms, spms ) );
+    tvec.push_back( terms::make_screening( Gph, phc, spms, sixj ) );
+    tvec.push_back( terms::make_ladder( Gpp, ppc, hhc, spms, sixj ) );
 // NOTE: no self energy is used for DERPA -- it's already in the "dressing"
 //    tvec.push_back( terms::make_self_energy( Gpp, ppms, hhms,
 //                                             ppspms, hhspms, spms ) );
@@ -1,8 +1,11 @@
 #ifndef _TERM_FACTORIES_H_
 #define _TERM_FACTORIES_H_
 
+#include <boost/shared_ptr.hpp>
+
 #include "Interaction.h"
 #include "Modelspace.h"
+#include "angular_momentum.h"
 #include "Term.h"
 
 std::vector< Term > build_rpa_terms( const PHInteraction &Gph,
@@ -19,20 +22,64 @@ std::vector< Term > build_static_erpa_terms(
 std::vector< Term > build_dynamic_erpa_terms(
                                     const PHInteraction &Gph,
                                     const PPInteraction &Gpp,
-                                    const ParticleHoleModelspace     &phms,
-                                    const ParticleParticleModelspace &ppms,
-                                    const ParticleParticleModelspace &hhms,
+                                    boost::shared_ptr< const StateChannels >
+                                                                      phc,
+                                    boost::shared_ptr< const StateChannels >
+                                                                      ppc,
+                                    boost::shared_ptr< const StateChannels >
+                                                                      hhc,
                                     const SEModelspace               &sems,
-                                    const SingleParticleModelspace   &spms );
+                                    const SingleParticleModelspace   &spms,
+                                    boost::shared_ptr< const Wigner6jTable >
+                                                                      sixj );
+
+// Energy independent forms of the dynamic ERPA terms, for MatrixFactory.
+// Screening, ladder and self energy are tabulated in a single sweep.  Their
+// B and B* blocks are added to B_terms, for build_static_erpa_matrix, and
+// share the intermediates of the tables.
+std::vector< PoleTerm > build_dynamic_erpa_pole_terms(
+                                    const PHInteraction &Gph,
+                                    const PPInteraction &Gpp,
+                                    boost::shared_ptr< const StateChannels >
+                                                                      phc,
+                                    boost::shared_ptr< const StateChannels >
+                                                                      ppc,
+                                    boost::shared_ptr< const StateChannels >
+                                                                      hhc,
+                                    const SEModelspace               &sems,
+                                    const SingleParticleModelspace   &spms,
+                                    boost::shared_ptr< const Wigner6jTable >
+                                                                      sixj,
+                                    std::vector< Term > &B_terms );
+
+// Only the pole tables.
+std::vector< PoleTerm > build_dynamic_erpa_pole_terms(
+                                    const PHInteraction &Gph,
+                                    const PPInteraction &Gpp,
+                                    boost::shared_ptr< const StateChannels >
+                                                                      phc,
+                                    boost::shared_ptr< const StateChannels >
+                                                                      ppc,
+                                    boost::shared_ptr< const StateChannels >
+                                                                      hhc,
+                                    const SEModelspace               &sems,
+                                    const SingleParticleModelspace   &spms,
+                                    boost::shared_ptr< const Wigner6jTable >
+                                                                      sixj );
 
 std::vector< Term > build_dynamic_derpa_terms(
                                     const PHInteraction &Gph,
                                     const PPInteraction &Gpp,
-                                    const ParticleHoleModelspace     &phms,
-                                    const ParticleParticleModelspace &ppms,
-                                    const ParticleParticleModelspace &hhms,
+                                    boost::shared_ptr< const StateChannels >
+                                                                      phc,
+                                    boost::shared_ptr< const StateChannels >
+                                                                      ppc,
+                                    boost::shared_ptr< const StateChannels >
+                                                                      hhc,
 //                                    const PPFromSPModelspace         &ppspms,
 //                                    const PPFromSPModelspace         &hhspms,
-                                    const SingleParticleModelspace   &spms );
+                                    const SingleParticleModelspace   &spms,
+                                    boost::shared_ptr< const Wigner6jTable >
+                                                                      sixj );
 
 #endif // _TERM_FACTORIES_H_
@@ -0,0 +1,142 @@
+#include <cmath>
+
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "exceptions.h"
+
+#include "Interaction.h"
+#include "InteractionTable.h"
+#include "Modelspace.h"
+
+#include "PoleTable.h"
+#include "IntermediateCache.h"
+#include "Term.h"
+
+#include "screening.h"
+#include "ladder.h"
+#include "self_energy.h"
+#include "dynamic_erpa.h"
+#include "pp_interaction_factories.h"
+#include "ph_interaction_factories.h"
+#include "modelspace_factories.h"
+
+namespace terms {
+
+DynamicERPAData::DynamicERPAData( const PHInteractionTable         &nGph,
+                                  const PPInteractionTable         &nGpp,
+                                  boost::shared_ptr< const StateChannels > nph,
+                                  boost::shared_ptr< const StateChannels > npp,
+                                  boost::shared_ptr< const StateChannels > nhh,
+                                  const SEModelspace               &nsems,
+                                  const SingleParticleModelspace   &nspms,
+                                  boost::shared_ptr< const Wigner6jTable >
+                                                                    nsixj )
+    : Gph( nGph ), Gpp( nGpp ),
+      ph( nph ), pp( npp ), hh( nhh ),
+      sems( nsems ), spms( nspms ),
+      screening_cache( new IntermediateCache ),
+      ladder_cache( new IntermediateCache ),
+      sixj( nsixj ),
+      self_energy( new SelfEnergyLines( nGpp, pp, hh, nsems, nspms ) ) { }
+
+void
+dynamic_erpa_poles( const std::vector< ParticleHoleState > &vec,
+                    PoleTable &A, PoleTable &A_star,
+                    boost::shared_ptr< const DynamicERPAData > data ) {
+    const DynamicERPAData &d = *data;
+    const SingleParticleModelspace &spms = d.spms;
+    int size = vec.size();
+
+    for ( int i = 0; i < size; ++i ) {
+        const ParticleHoleState &ph1 = vec[i];
+        double Sa = spms.pfrag[ph1.ip][ph1.ipf].S
+                  * spms.hfrag[ph1.ih][ph1.ihf].S;
+        for ( int k = i; k < size; ++k ) {
+            const ParticleHoleState &ph2 = vec[k];
+            double S = Sa * spms.pfrag[ph2.ip][ph2.ipf].S
+                          * spms.hfrag[ph2.ih][ph2.ihf].S;
+            // Phase for A*, always 1 on the diagonal
+            int phase = std::pow( -1.0, spms.j[ ph1.ip ] + spms.j[ ph1.ih ]
+                                      + spms.j[ ph2.ip ] + spms.j[ ph2.ih ] );
+
+            PoleSum poles;
+            add( poles, internal::screening_A_poles( ph1, ph2, d.Gph,
+                        *d.ph, spms, *d.screening_cache, *d.sixj ), S );
+            add( poles, internal::ladder_A_poles( ph1, ph2, d.Gpp,
+                        *d.pp, *d.hh, spms, *d.ladder_cache, *d.sixj ), S );
+            // self energy terms show up only on the diagonal
+            if ( i == k )
+                add( poles, d.self_energy->poles( ph1 ) );
+            compress( poles );
+
+            add( A( i, k ), poles );
+            add( A_star( i, k ), reflect( poles ), -phase ); } }
+}
+
+void
+dynamic_erpa_B( const std::vector< ParticleHoleState > &vec, double E,
+                TermBlock &block,
+                boost::shared_ptr< const DynamicERPAData > data ) {
+    if ( ENUM_A == block.pos or ENUM_A_STAR == block.pos )
+        return;
+
+    const DynamicERPAData &d = *data;
+    const SingleParticleModelspace &spms = d.spms;
+    int size = vec.size();
+
+    for ( int i = 0; i < size; ++i ) {
+        const ParticleHoleState &ph1 = vec[i];
+        double Sa = spms.pfrag[ph1.ip][ph1.ipf].S
+                  * spms.hfrag[ph1.ih][ph1.ihf].S;
+        for ( int k = i; k < size; ++k ) {
+            const ParticleHoleState &ph2 = vec[k];
+            double S = Sa * spms.pfrag[ph2.ip][ph2.ipf].S
+                          * spms.hfrag[ph2.ih][ph2.ihf].S;
+
+            double value = S
+              * ( internal::screening_B_term( ph1, ph2, d.Gph, *d.ph, spms,
+                                              *d.screening_cache, *d.sixj )
+                + internal::ladder_B_term( ph1, ph2, d.Gpp, *d.pp, *d.hh,
+                                           spms, *d.ladder_cache, *d.sixj ) );
+            switch ( block.pos ) {
+                case ENUM_B:
+                    break;
+                case ENUM_B_STAR:
+                    // Phase for B*
+                    value *= std::pow( -1.0,
+                                spms.j[ ph1.ip ] + spms.j[ ph1.ih ]
+                              + spms.j[ ph2.ip ] + spms.j[ ph2.ih ] );
+                    break;
+                default:
+                    throw invalid_matrix_position(); }
+            block.add( i, k, value ); } }
+    return;
+    // Dummy code for unused E
+    ++E;
+}
+
+boost::shared_ptr< const DynamicERPAData >
+make_dynamic_erpa_data( const PHInteraction &Gph,
+                        const PPInteraction &Gpp,
+                        boost::shared_ptr< const StateChannels > ph,
+                        boost::shared_ptr< const StateChannels > pp,
+                        boost::shared_ptr< const StateChannels > hh,
+                        const SEModelspace               &sems,
+                        const SingleParticleModelspace   &spms,
+                        boost::shared_ptr< const Wigner6jTable > sixj ) {
+    return boost::shared_ptr< const DynamicERPAData >( new DynamicERPAData(
+                as_ph_table( Gph, spms ), as_pp_table( Gpp, spms ),
+                ph, pp, hh, sems, spms, sixj ) );
+}
+
+PoleTerm make_dynamic_erpa_poles(
+        boost::shared_ptr< const DynamicERPAData > data ) {
+    return boost::bind( dynamic_erpa_poles, _1, _2, _3, data );
+}
+
+Term make_dynamic_erpa_B( boost::shared_ptr< const DynamicERPAData > data ) {
+    return boost::bind( dynamic_erpa_B, _1, _2, _3, data );
+}
+
+} // end namespace terms
@@ -0,0 +1,81 @@
+#ifndef _RPA_TERMS_DYNAMIC_ERPA_H_
+#define _RPA_TERMS_DYNAMIC_ERPA_H_
+/* The screening, ladder and self energy terms tabulated together.
+ *
+ * Each term on its own sweeps the whole basis.  Here a single sweep adds the
+ * pole sums of all three for every element, sharing the spectroscopic
+ * factors and the A* phase, and fills the A and A* tables from the same
+ * combined sum.  The B and B* blocks, which do not depend on the energy, are
+ * filled from the same intermediates for the static matrix.
+ */
+
+#include <boost/shared_ptr.hpp>
+
+#include "Interaction.h"
+#include "InteractionTable.h"
+#include "Modelspace.h"
+
+#include "PoleTable.h"
+#include "IntermediateCache.h"
+#include "angular_momentum.h"
+#include "Term.h"
+#include "self_energy.h"
+
+namespace terms {
+
+// Constant public data members allow for a simple interface.  sems and
+// spms are owned by the caller.
+struct DynamicERPAData {
+    DynamicERPAData( const PHInteractionTable         &nGph,
+                     const PPInteractionTable         &nGpp,
+                     boost::shared_ptr< const StateChannels > nph,
+                     boost::shared_ptr< const StateChannels > npp,
+                     boost::shared_ptr< const StateChannels > nhh,
+                     const SEModelspace               &nsems,
+                     const SingleParticleModelspace   &nspms,
+                     boost::shared_ptr< const Wigner6jTable >
+                                                       nsixj );
+    PHInteractionTable                       Gph;
+    PPInteractionTable                       Gpp;
+    boost::shared_ptr< const StateChannels > ph;
+    boost::shared_ptr< const StateChannels > pp;
+    boost::shared_ptr< const StateChannels > hh;
+    const SEModelspace                      &sems;
+    const SingleParticleModelspace          &spms;
+    // Screening and ladder intermediates use the same keys
+    boost::shared_ptr< IntermediateCache >   screening_cache;
+    boost::shared_ptr< IntermediateCache >   ladder_cache;
+    boost::shared_ptr< const Wigner6jTable > sixj;
+    boost::shared_ptr< SelfEnergyLines >     self_energy;
+};
+
+void
+dynamic_erpa_poles( const std::vector< ParticleHoleState > &vec,
+                    PoleTable &A, PoleTable &A_star,
+                    boost::shared_ptr< const DynamicERPAData > data );
+
+// Only the B and B* blocks of screening and ladder; A and A* are left to
+// the pole tables and the self energy has no B.  E is not used.
+void
+dynamic_erpa_B( const std::vector< ParticleHoleState > &vec, double E,
+                TermBlock &block,
+                boost::shared_ptr< const DynamicERPAData > data );
+
+boost::shared_ptr< const DynamicERPAData >
+make_dynamic_erpa_data( const PHInteraction &Gph,
+                        const PPInteraction &Gpp,
+                        boost::shared_ptr< const StateChannels > ph,
+                        boost::shared_ptr< const StateChannels > pp,
+                        boost::shared_ptr< const StateChannels > hh,
+                        const SEModelspace               &sems,
+                        const SingleParticleModelspace   &spms,
+                        boost::shared_ptr< const Wigner6jTable > sixj );
+
+PoleTerm make_dynamic_erpa_poles(
+        boost::shared_ptr< const DynamicERPAData > data );
+
+Term make_dynamic_erpa_B( boost::shared_ptr< const DynamicERPAData > data );
+
+} // end namespace terms
+
+#endif // _RPA_TERMS_DYNAMIC_ERPA_H_
@@ -6,21 +6,22 @@
 
 #include "Modelspace.h"
 #include "Interaction.h"
+#include "InteractionTable.h"
 
 #include "Term.h"
 #include "first_order.h"
+#include "ph_interaction_factories.h"
 
 #include "exceptions.h"
 
 namespace terms {
 
-util::matrix_t
+void
 first_order( const std::vector< ParticleHoleState > &vec, double E,
-             position_t pos, const PHInteraction &Gph,
+             TermBlock &block,
+             const PHInteractionTable &Gph,
              const SingleParticleModelspace &spms ) {
     unsigned int size = vec.size();
-    util::matrix_t m( size, size );
-    m.clear();
 
     for ( unsigned int i=0; i < size; ++i ) {
         const ParticleHoleState &ph1 = vec[i];
@@ -33,26 +34,21 @@ first_order( const std::vector< ParticleHoleState > &vec, double E,
             double S = Sa * spms.pfrag[ ph2.ip ][ ph2.ipf ].S
                           * spms.hfrag[ ph2.ih ][ ph2.ihf ].S;
 
-            double value;
             int phase = 1;
-            switch ( pos ) {
+            switch ( block.pos ) {
                 case ENUM_A_STAR:
                 case ENUM_A: // A and A* are hermitian, but we pretend sym.
-                    value = S * Gph( ph1, ph2 );
-                    m( i, k ) = value;
-                    m( k, i ) = value;
+                    block.add( i, k, S * Gph( ph1, ph2 ) );
                     break;
                 case ENUM_B_STAR:
                 case ENUM_B: // B and B* are symmetric
                     phase *= std::pow( -1.0, spms.j[ph2.ip] - spms.j[ph2.ih]
                                            + ph2.J );
-                    value = S * Gph( ph1, r_ph2 );
-                    m( i, k ) = phase * value;
-                    m( k, i ) = phase * value;
+                    block.add( i, k, phase * S * Gph( ph1, r_ph2 ) );
                     break;
                 default:
                     throw invalid_matrix_position(); } } }
-    return m;
+    return;
     // Dummy code for unused E
     ++E;
 }
@@ -60,7 +56,7 @@ first_order( const std::vector< ParticleHoleState > &vec, double E,
 Term make_first_order( const PHInteraction &Gph,
                        const SingleParticleModelspace &spms ) {
     return boost::bind( first_order, _1, _2, _3,
-            boost::cref(Gph), boost::cref(spms) );
+            as_ph_table( Gph, spms ), boost::cref(spms) );
 }
 
 } // end namespace terms
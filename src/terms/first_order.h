@@ -4,15 +4,17 @@
 #include "linalg.h"
 
 #include "Interaction.h"
+#include "InteractionTable.h"
 #include "Modelspace.h"
 
 #include "Term.h"
 
 namespace terms {
 
-util::matrix_t
+void
 first_order( const std::vector< ParticleHoleState > &vec, double E,
-             position_t pos, const PHInteraction &Gph,
+             TermBlock &block,
+             const PHInteractionTable &Gph,
              const SingleParticleModelspace &spms );
 
 Term make_first_order( const PHInteraction &Gph,
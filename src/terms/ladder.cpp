@@ -1,39 +1,47 @@
 #include <cmath>
 #include <cassert>
+#include <vector>
 
 #include <boost/bind.hpp>
 #include <boost/foreach.hpp>
 #include <boost/numeric/conversion/cast.hpp>
+#include <boost/shared_ptr.hpp>
 
 #include "linalg.h"
 #include "exceptions.h"
 #include "angular_momentum.h"
 
 #include "Interaction.h"
+#include "InteractionTable.h"
 #include "Modelspace.h"
 
+#include "PoleTable.h"
+#include "IntermediateCache.h"
 #include "Term.h"
 
 #include "ladder.h"
+#include "pp_interaction_factories.h"
+#include "modelspace_factories.h"
 
 namespace terms {
 
-util::matrix_t
+void
 ladder( const std::vector< ParticleHoleState > &vec, double E,
-        position_t pos, const PPInteraction &Gpp,
-        const ParticleParticleModelspace &ppms,
-        const ParticleParticleModelspace &hhms,
-        const SingleParticleModelspace &spms ) {
+        TermBlock &block,
+        const PPInteractionTable &Gpp,
+        boost::shared_ptr< const StateChannels > ppc,
+        boost::shared_ptr< const StateChannels > hhc,
+        const SingleParticleModelspace &spms,
+        boost::shared_ptr< IntermediateCache > cache,
+        boost::shared_ptr< const Wigner6jTable > sixj ) {
     int size = vec.size();
-    util::matrix_t m( size, size );
-    m.clear();
 
     for ( int i = 0; i < size; ++i ) {
-        ParticleHoleState ph1 = vec[i];
+        const ParticleHoleState &ph1 = vec[i];
         double Sa = spms.pfrag[ph1.ip][ph1.ipf].S
                   * spms.hfrag[ph1.ih][ph1.ihf].S;
         for ( int k = i; k < size; ++k ) {
-            ParticleHoleState ph2 = vec[k];
+            const ParticleHoleState &ph2 = vec[k];
             double S = Sa * spms.pfrag[ph2.ip][ph2.ipf].S
                           * spms.hfrag[ph2.ih][ph2.ihf].S;
             // Phase for A* and B*
@@ -41,57 +49,62 @@ ladder( const std::vector< ParticleHoleState > &vec, double E,
                                       + spms.j[ ph2.ip ] + spms.j[ ph2.ih ] );
             // NOTE: Assuming real valued, so A and B are symmetric
             //   (A is normally Hermitian)
-            switch ( pos ) {
+            double value;
+            switch ( block.pos ) {
                 case ENUM_A:
-                    m( k, i ) = m( i, k ) = S
+                    value = S
                      * internal::ladder_A_term( ph1, ph2, E, Gpp,
-                               ppms, hhms, spms );
+                               *ppc, *hhc, spms, *cache, *sixj );
                     break;
                 case ENUM_A_STAR:
-                    m( k, i ) = m( i, k ) = phase * S
+                    value = phase * S
                      * internal::ladder_A_term( ph1, ph2, -E, Gpp,
-                               ppms, hhms, spms );
+                               *ppc, *hhc, spms, *cache, *sixj );
                     break;
                 case ENUM_B:
-                    m( k, i ) = m( i, k ) = S
+                    value = S
                      * internal::ladder_B_term( ph1, ph2, Gpp,
-                               ppms, hhms, spms );
+                               *ppc, *hhc, spms, *cache, *sixj );
                     break;
                 case ENUM_B_STAR:
-                    m( k, i ) = m( i, k ) = phase * S
+                    value = phase * S
                      * internal::ladder_B_term( ph1, ph2, Gpp,
-                               ppms, hhms, spms );
+                               *ppc, *hhc, spms, *cache, *sixj );
                     break;
                 default:
-                    throw invalid_matrix_position(); } } }
-    return m;
+                    throw invalid_matrix_position(); }
+            block.add( i, k, value ); } }
 }
 
 namespace internal {
 
 double ladder_A_term( const ParticleHoleState &ph1,
                       const ParticleHoleState &ph2, double E,
-                      const PPInteraction &Gpp,
-                      const ParticleParticleModelspace   &ppms,
-                      const ParticleParticleModelspace   &hhms,
-                      const SingleParticleModelspace &spms ) {
-    typedef ParticleParticleState pp_t;
+                      const PPInteractionTable &Gpp,
+                      const StateChannels &ppc,
+                      const StateChannels &hhc,
+                      const SingleParticleModelspace &spms,
+                      IntermediateCache &cache,
+                      const Wigner6jTable &sixj ) {
+    return evaluate( ladder_A_poles( ph1, ph2, Gpp, ppc, hhc, spms,
+                                     cache, sixj ), E ); }
+
+PoleSum ladder_A_poles( const ParticleHoleState &ph1,
+                        const ParticleHoleState &ph2,
+                        const PPInteractionTable &Gpp,
+                        const StateChannels &ppc,
+                        const StateChannels &hhc,
+                        const SingleParticleModelspace &spms,
+                        IntermediateCache &cache,
+                        const Wigner6jTable &sixj ) {
     // Shell indicies
     int ia = ph1.ip;
     int ib = ph1.ih;
     int ic = ph2.ip;
     int id = ph2.ih;
 
-    // Fragment indicies
-    int iaf = ph1.ipf;
-    int ibf = ph1.ihf;
-    int icf = ph2.ipf;
-    int idf = ph2.ihf;
-
     // Useful items
     int J      = ph1.J;
-    int tz     = boost::numeric_cast<int>(spms.tz[ia] + spms.tz[id]);
-    int parity = spms.parity[ia] * spms.parity[id];
 
     // Quick asserts
     assert( ph1.J == ph2.J );
@@ -102,65 +115,109 @@ double ladder_A_term( const ParticleHoleState &ph1,
     int Jpmin = std::max( std::abs( spms.j[ia] - spms.j[id] ),
                           std::abs( spms.j[ib] - spms.j[ic] ) );
     int Jpmax = std::min( spms.j[ia] + spms.j[id], spms.j[ib] + spms.j[ic] );
-    assert( Jpmax < boost::numeric_cast<int>(ppms[1+tz][(parity+1)/2].size()) );
 
-    double result = 0;
+    PoleSum result;
     for ( int Jp = Jpmin; Jp <= Jpmax; ++Jp ) {
-        pp_t left ( ia, id, -1, -1, Jp );
-        pp_t right( ic, ib, -1, -1, Jp );
-        double JpTerm = 0;
-        // Intermediate terms above Fermi surface
-//        assert( 0 != ppms[1 + tz][(parity+1)/2][Jp].size() );
-        BOOST_FOREACH(pp_t i_pp, ppms[1 + tz][(parity+1)/2][Jp]) {
-            assert( parity == spms.parity[i_pp.ip1]*spms.parity[i_pp.ip2] );
-            double Si_pp = spms.pfrag[i_pp.ip1][i_pp.ip1f].S
-                         * spms.pfrag[i_pp.ip2][i_pp.ip2f].S;
-            JpTerm += Si_pp * Gpp( left, i_pp ) * Gpp( i_pp, right ) /
-                ( E - ( - spms.hfrag[ib][ibf].E - spms.hfrag[id][idf].E
-                        + spms.pfrag[i_pp.ip1][i_pp.ip1f].E
-                        + spms.pfrag[i_pp.ip2][i_pp.ip2f].E ) );
-        }
-        // Intermediate terms below Fermi surface
-//        assert( 0 != hhms[1 + tz][(parity+1)/2][Jp].size() );
-        BOOST_FOREACH(pp_t i_hh, hhms[1 + tz][(parity+1)/2][Jp]) {
-            assert( parity == spms.parity[i_hh.ip1]*spms.parity[i_hh.ip2] );
-            double Si_hh = spms.hfrag[i_hh.ip1][i_hh.ip1f].S
-                         * spms.hfrag[i_hh.ip2][i_hh.ip2f].S;
-            JpTerm += Si_hh * Gpp( left, i_hh ) * Gpp( i_hh, right ) /
-                ( E - ( spms.pfrag[ia][iaf].E + spms.pfrag[ic][icf].E
-                        - spms.hfrag[i_hh.ip1][i_hh.ip1f].E
-                        - spms.hfrag[i_hh.ip2][i_hh.ip2f].E ) );
-        }
-        result -= JpTerm * (  2 * Jp + 1 )
-                * wigner6j( spms.j[ia], spms.j[ib], J,
+        double coef = - (  2 * Jp + 1 )
+                    * sixj( spms.j[ia], spms.j[ib], J,
                             spms.j[ic], spms.j[id], Jp );
+        if ( 0 == coef )
+            continue;
+        IntermediateKey key( ia, ib, ic, id,
+                             ph1.ipf, ph1.ihf, ph2.ipf, ph2.ihf, Jp );
+        add( result, ladder_A_intermediate( key, find_ladder_shell( key, Gpp,
+                        ppc, hhc, spms, cache ), spms ), coef );
     }
+    compress( result );
+    return result;
+}
+
+ShellIntermediate ladder_shell_intermediate(
+                               const IntermediateKey &key,
+                               const PPInteractionTable &Gpp,
+                               const StateChannels &ppc,
+                               const StateChannels &hhc,
+                               const SingleParticleModelspace &spms ) {
+    int tz     = boost::numeric_cast<int>(spms.tz[key.a] + spms.tz[key.d]);
+    int parity = spms.parity[key.a] * spms.parity[key.d];
+    assert( key.Jp < ppc.num_J( tz, parity ) );
+
+    // The products G( a, d, i ) * G( i, c, b ) for every intermediate pair i
+    // of the channel are one elementwise product of two dense rows.  The
+    // phase of i cancels, so the rows are taken with i1 <= i2.
+    PPInteractionTable::Channel G = Gpp.channel( tz, parity, key.Jp );
+    std::vector< double > left, right;
+    G.row( key.a, key.d, left );
+    G.row( key.c, key.b, right );
+    std::vector< double > GG( G.dimension() );
+    for ( int n = 0; n < G.dimension(); ++n ) {
+        GG[n] = left[n] * right[n]; }
+
+    ShellIntermediate result;
+    // Intermediate terms above Fermi surface
+    int end = ppc.end( tz, parity, key.Jp );
+    result.forward.poles.reserve( end - ppc.begin( tz, parity, key.Jp ) );
+    for ( int n = ppc.begin( tz, parity, key.Jp ); n < end; ++n ) {
+        assert( parity == spms.parity[ppc.i1[n]]*spms.parity[ppc.i2[n]] );
+        add_pole( result.forward,
+                  ppc.S[n] * GG[ G.position( ppc.i1[n], ppc.i2[n] ) ],
+                  ppc.E[n] );
+    }
+    // Intermediate terms below Fermi surface
+    end = hhc.end( tz, parity, key.Jp );
+    result.backward.poles.reserve( end - hhc.begin( tz, parity, key.Jp ) );
+    for ( int n = hhc.begin( tz, parity, key.Jp ); n < end; ++n ) {
+        assert( parity == spms.parity[hhc.i1[n]]*spms.parity[hhc.i2[n]] );
+        add_pole( result.backward,
+                  hhc.S[n] * GG[ G.position( hhc.i1[n], hhc.i2[n] ) ],
+                  - hhc.E[n] );
+    }
+    compress( result.forward );
+    compress( result.backward );
+    return result;
+}
+
+const ShellIntermediate &find_ladder_shell(
+                               const IntermediateKey &key,
+                               const PPInteractionTable &Gpp,
+                               const StateChannels &ppc,
+                               const StateChannels &hhc,
+                               const SingleParticleModelspace &spms,
+                               IntermediateCache &cache ) {
+    IntermediateKey shells = key.shells();
+    const ShellIntermediate *shell = cache.find_shell( shells );
+    if ( !shell )
+        shell = &cache.insert_shell( shells,
+                ladder_shell_intermediate( shells, Gpp, ppc, hhc, spms ) );
+    return *shell; }
+
+PoleSum ladder_A_intermediate( const IntermediateKey &key,
+                               const ShellIntermediate &shell,
+                               const SingleParticleModelspace &spms ) {
+    PoleSum result = shift( shell.forward,
+            - spms.hfrag[key.b][key.bf].E - spms.hfrag[key.d][key.df].E );
+    add( result, shift( shell.backward,
+            spms.pfrag[key.a][key.af].E + spms.pfrag[key.c][key.cf].E ) );
+    compress( result );
     return result;
 }
 
 double ladder_B_term( const ParticleHoleState &ph1,
                       const ParticleHoleState &ph2,
-                      const PPInteraction &Gpp,
-                      const ParticleParticleModelspace   &ppms,
-                      const ParticleParticleModelspace   &hhms,
-                      const SingleParticleModelspace &spms ) {
-    typedef ParticleParticleState pp_t;
+                      const PPInteractionTable &Gpp,
+                      const StateChannels &ppc,
+                      const StateChannels &hhc,
+                      const SingleParticleModelspace &spms,
+                      IntermediateCache &cache,
+                      const Wigner6jTable &sixj ) {
     // Shell indicies
     int ia = ph1.ip;
     int ib = ph1.ih;
     int ic = ph2.ih;
     int id = ph2.ip;
 
-    // Fragment indicies
-    int iaf = ph1.ipf;
-    int ibf = ph1.ihf;
-    int icf = ph2.ihf;
-    int idf = ph2.ipf;
-
     // Useful items
     int J      = ph1.J;
-    int tz     = boost::numeric_cast<int>(spms.tz[ia] + spms.tz[id]);
-    int parity = spms.parity[ia] * spms.parity[id];
 
     // Quick asserts
     assert( ph1.J == ph2.J );
@@ -171,48 +228,42 @@ double ladder_B_term( const ParticleHoleState &ph1,
     int Jpmin = std::max( std::abs( spms.j[ia] - spms.j[id] ),
                           std::abs( spms.j[ib] - spms.j[ic] ) );
     int Jpmax = std::min( spms.j[ia] + spms.j[id], spms.j[ib] + spms.j[ic] );
-    assert( Jpmax < boost::numeric_cast<int>(ppms[1+tz][(parity+1)/2].size()) );
 
     double result = 0;
     for ( int Jp = Jpmin; Jp <= Jpmax; ++Jp ) {
-        pp_t left ( ia, id, -1, -1, Jp );
-        pp_t right( ic, ib, -1, -1, Jp );
-        double JpTerm = 0;
-        // Intermediate terms above Fermi surface
-        BOOST_FOREACH(pp_t i_pp, ppms[1 + tz][(parity+1)/2][Jp]) {
-            assert( parity == spms.parity[i_pp.ip1]*spms.parity[i_pp.ip2] );
-            double Si_pp = spms.pfrag[i_pp.ip1][i_pp.ip1f].S
-                         * spms.pfrag[i_pp.ip2][i_pp.ip2f].S;
-            JpTerm += Si_pp * Gpp( left, i_pp ) * Gpp( i_pp, right ) /
-                - ( - spms.hfrag[ib][ibf].E - spms.hfrag[ic][icf].E
-                    + spms.pfrag[i_pp.ip1][i_pp.ip1f].E
-                    + spms.pfrag[i_pp.ip2][i_pp.ip2f].E );
-        }
-        // Intermediate terms below Fermi surface
-        BOOST_FOREACH(pp_t i_hh, hhms[1 + tz][(parity+1)/2][Jp]) {
-            assert( parity == spms.parity[i_hh.ip1]*spms.parity[i_hh.ip2] );
-            double Si_hh = spms.hfrag[i_hh.ip1][i_hh.ip1f].S
-                         * spms.hfrag[i_hh.ip2][i_hh.ip2f].S;
-            JpTerm += Si_hh * Gpp( left, i_hh ) * Gpp( i_hh, right ) /
-                - (   spms.pfrag[ia][iaf].E + spms.pfrag[id][idf].E
-                    - spms.hfrag[i_hh.ip1][i_hh.ip1f].E
-                    - spms.hfrag[i_hh.ip2][i_hh.ip2f].E );
-        }
+        // NOTE: c is now a hole fragment, and d a particle fragment
+        IntermediateKey key( ia, ib, ic, id,
+                             ph1.ipf, ph1.ihf, ph2.ihf, ph2.ipf, Jp );
+        double JpTerm = ladder_B_intermediate( key, find_ladder_shell( key,
+                    Gpp, ppc, hhc, spms, cache ), spms );
         result -= JpTerm * (  2 * Jp + 1 )
-                * wigner6j( spms.j[ia], spms.j[ib], J,
-                            spms.j[ic], spms.j[id], Jp );
+                * sixj( spms.j[ia], spms.j[ib], J,
+                        spms.j[ic], spms.j[id], Jp );
     }
     return result;
 }
 
+// NOTE: c is a hole fragment, and d a particle fragment
+double ladder_B_intermediate( const IntermediateKey &key,
+                              const ShellIntermediate &shell,
+                              const SingleParticleModelspace &spms ) {
+    return evaluate( shell.forward,
+              spms.hfrag[key.b][key.bf].E + spms.hfrag[key.c][key.cf].E )
+         + evaluate( shell.backward,
+              - spms.pfrag[key.a][key.af].E - spms.pfrag[key.d][key.df].E );
+}
+
 } // end namespace internal
 
 Term make_ladder( const PPInteraction &Gpp,
-                  const ParticleParticleModelspace &ppms,
-                  const ParticleParticleModelspace &hhms,
-                  const SingleParticleModelspace &spms ) {
-    return boost::bind( ladder, _1, _2, _3, boost::cref(Gpp),
-            boost::cref(ppms), boost::cref(hhms), boost::cref(spms) );
+                  boost::shared_ptr< const StateChannels > ppc,
+                  boost::shared_ptr< const StateChannels > hhc,
+                  const SingleParticleModelspace &spms,
+                  boost::shared_ptr< const Wigner6jTable > sixj ) {
+    boost::shared_ptr< IntermediateCache > cache( new IntermediateCache );
+    return boost::bind( ladder, _1, _2, _3,
+            as_pp_table( Gpp, spms ), ppc, hhc, boost::cref(spms), cache,
+            sixj );
 }
 
 } // end namespace terms
@@ -1,41 +1,87 @@
 #ifndef _RPA_TERMS_LADDER_H_
 #define _RPA_TERMS_LADDER_H_
 
+#include <boost/shared_ptr.hpp>
+
 #include "linalg.h"
 
 #include "Interaction.h"
+#include "InteractionTable.h"
 #include "Modelspace.h"
 
+#include "PoleTable.h"
+#include "IntermediateCache.h"
+#include "angular_momentum.h"
 #include "Term.h"
 
 namespace terms {
 
-util::matrix_t
+void
 ladder( const std::vector< ParticleHoleState > &vec, double E,
-        position_t pos, const PPInteraction &Gpp,
-        const ParticleParticleModelspace &ppms,
-        const ParticleParticleModelspace &hhms,
-        const SingleParticleModelspace &spms );
+        TermBlock &block,
+        const PPInteractionTable &Gpp,
+        boost::shared_ptr< const StateChannels > ppc,
+        boost::shared_ptr< const StateChannels > hhc,
+        const SingleParticleModelspace &spms,
+        boost::shared_ptr< IntermediateCache > cache,
+        boost::shared_ptr< const Wigner6jTable > sixj );
 
+// The intermediate sums are shared by every J, and are stored in cache.
 namespace internal {
 double ladder_A_term( const ParticleHoleState &ph1,
                       const ParticleHoleState &ph2, double E,
-                      const PPInteraction &Gpp,
-                      const ParticleParticleModelspace &ppms,
-                      const ParticleParticleModelspace &hhms,
-                      const SingleParticleModelspace &spms );
+                      const PPInteractionTable &Gpp,
+                      const StateChannels &ppc,
+                      const StateChannels &hhc,
+                      const SingleParticleModelspace &spms,
+                      IntermediateCache &cache,
+                      const Wigner6jTable &sixj );
+PoleSum ladder_A_poles( const ParticleHoleState &ph1,
+                        const ParticleHoleState &ph2,
+                        const PPInteractionTable &Gpp,
+                        const StateChannels &ppc,
+                        const StateChannels &hhc,
+                        const SingleParticleModelspace &spms,
+                        IntermediateCache &cache,
+                        const Wigner6jTable &sixj );
 double ladder_B_term( const ParticleHoleState &ph1,
                       const ParticleHoleState &ph2,
-                      const PPInteraction &Gpp,
-                      const ParticleParticleModelspace &ppms,
-                      const ParticleParticleModelspace &hhms,
-                      const SingleParticleModelspace &spms );
+                      const PPInteractionTable &Gpp,
+                      const StateChannels &ppc,
+                      const StateChannels &hhc,
+                      const SingleParticleModelspace &spms,
+                      IntermediateCache &cache,
+                      const Wigner6jTable &sixj );
+
+// Sums over intermediate states for a single Jp, without the recoupling
+// coefficient.  The shell sums hold the interaction products; the others
+// add the energies of the external fragments.
+ShellIntermediate ladder_shell_intermediate(
+                               const IntermediateKey &key,
+                               const PPInteractionTable &Gpp,
+                               const StateChannels &ppc,
+                               const StateChannels &hhc,
+                               const SingleParticleModelspace &spms );
+const ShellIntermediate &find_ladder_shell(
+                               const IntermediateKey &key,
+                               const PPInteractionTable &Gpp,
+                               const StateChannels &ppc,
+                               const StateChannels &hhc,
+                               const SingleParticleModelspace &spms,
+                               IntermediateCache &cache );
+PoleSum ladder_A_intermediate( const IntermediateKey &key,
+                               const ShellIntermediate &shell,
+                               const SingleParticleModelspace &spms );
+double ladder_B_intermediate( const IntermediateKey &key,
+                              const ShellIntermediate &shell,
+                              const SingleParticleModelspace &spms );
 } // end namespace internal
 
 Term make_ladder( const PPInteraction &Gpp,
-                  const ParticleParticleModelspace &ppms,
-                  const ParticleParticleModelspace &hhms,
-                  const SingleParticleModelspace &spms );
+                  boost::shared_ptr< const StateChannels > ppc,
+                  boost::shared_ptr< const StateChannels > hhc,
+                  const SingleParticleModelspace &spms,
+                  boost::shared_ptr< const Wigner6jTable > sixj );
 
 } // end namespace terms
 
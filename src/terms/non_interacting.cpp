@@ -12,35 +12,36 @@
 
 namespace terms {
 
-util::matrix_t
+void
 non_interacting( const std::vector< ParticleHoleState > &vec, double E,
-                 position_t pos, const SingleParticleModelspace &spms ) {
+                 TermBlock &block,
+                 const SingleParticleModelspace &spms ) {
     int size = vec.size();
-    util::matrix_t m( size, size );
-    m.clear();
 
-    if ( ENUM_B == pos || ENUM_B_STAR == pos )
-        return m;
+    if ( ENUM_B == block.pos || ENUM_B_STAR == block.pos )
+        return;
 
     for ( int i=0; i < size; ++i ) {
         int ip  = vec[i].ip;
         int ih  = vec[i].ih;
         int ipf = vec[i].ipf;
         int ihf = vec[i].ihf;
-        switch ( pos ) {
+        switch ( block.pos ) {
             case ENUM_A:
             case ENUM_A_STAR:
-                    m( i, i ) = spms.pfrag[ip][ipf].E - spms.hfrag[ih][ihf].E;
+                    block.add( i, i, spms.pfrag[ip][ipf].E
+                                   - spms.hfrag[ih][ihf].E );
                 break;
             default:
                 throw invalid_matrix_position(); } }
-    return m;
+    return;
     // Dummy code for unused E
     ++E;
 }
 
 Term make_non_interacting( const SingleParticleModelspace &spms ) {
-    return boost::bind( non_interacting, _1, _2, _3, spms );
+    return boost::bind( non_interacting, _1, _2, _3,
+            boost::cref(spms) );
 }
 
 } // end namespace terms
@@ -10,9 +10,10 @@
 
 namespace terms {
 
-util::matrix_t
+void
 non_interacting( const std::vector< ParticleHoleState > &vec, double E,
-                 position_t pos, const SingleParticleModelspace &spms );
+                 TermBlock &block,
+                 const SingleParticleModelspace &spms );
 
 Term make_non_interacting( const SingleParticleModelspace &spms );
 
@@ -1,38 +1,46 @@
 #include <cassert>
 #include <cmath>
+#include <vector>
 
 #include <boost/bind.hpp>
 #include <boost/foreach.hpp>
 #include <boost/numeric/conversion/cast.hpp>
+#include <boost/shared_ptr.hpp>
 
 #include "linalg.h"
 #include "angular_momentum.h"
 #include "exceptions.h"
 
 #include "Interaction.h"
+#include "InteractionTable.h"
 #include "Modelspace.h"
 
+#include "PoleTable.h"
+#include "IntermediateCache.h"
 #include "Term.h"
 
 #include "screening.h"
+#include "ph_interaction_factories.h"
+#include "modelspace_factories.h"
 
 namespace terms {
 
-util::matrix_t
+void
 screening( const std::vector< ParticleHoleState > &vec, double E,
-           position_t pos, const PHInteraction &Gph,
-           const ParticleHoleModelspace   &phms,
-           const SingleParticleModelspace &spms ) {
+           TermBlock &block,
+           const PHInteractionTable &Gph,
+           boost::shared_ptr< const StateChannels > phc,
+           const SingleParticleModelspace &spms,
+           boost::shared_ptr< IntermediateCache > cache,
+           boost::shared_ptr< const Wigner6jTable > sixj ) {
     int size = vec.size();
-    util::matrix_t m( size, size );
-    m.clear();
 
     for ( int i = 0; i < size; ++i ) {
-        ParticleHoleState ph1 = vec[i];
+        const ParticleHoleState &ph1 = vec[i];
         double Sa = spms.pfrag[ph1.ip][ph1.ipf].S
                   * spms.hfrag[ph1.ih][ph1.ihf].S;
         for ( int k = i; k < size; ++k ) {
-            ParticleHoleState ph2 = vec[k];
+            const ParticleHoleState &ph2 = vec[k];
             double S = Sa * spms.pfrag[ph2.ip][ph2.ipf].S
                           * spms.hfrag[ph2.ih][ph2.ihf].S;
 
@@ -41,55 +49,60 @@ screening( const std::vector< ParticleHoleState > &vec, double E,
                                       + spms.j[ ph2.ip ] + spms.j[ ph2.ih ] );
             // NOTE: Assuming real valued, so A and B are symmetric
             //   (A is normally Hermitian)
-            switch ( pos ) {
+            double value;
+            switch ( block.pos ) {
                 case ENUM_A:
-                    m( k, i ) = m( i, k ) = S
+                    value = S
                       * internal::screening_A_term( ph1, ph2, E,
-                                Gph, phms, spms );
+                                Gph, *phc, spms, *cache, *sixj );
                     break;
                 case ENUM_A_STAR:
-                    m( k, i ) = m( i, k ) = phase * S
+                    value = phase * S
                       * internal::screening_A_term( ph1, ph2, -E,
-                                Gph, phms, spms );
+                                Gph, *phc, spms, *cache, *sixj );
                     break;
                 case ENUM_B:
-                    m( k, i ) = m( i, k ) = S
-                      * internal::screening_B_term( ph1, ph2, Gph, phms, spms );
+                    value = S
+                      * internal::screening_B_term( ph1, ph2, Gph, *phc, spms,
+                                                   *cache, *sixj );
                     break;
                 case ENUM_B_STAR:
-                    m( k, i ) = m( i, k ) = phase * S
-                      * internal::screening_B_term( ph1, ph2, Gph, phms, spms );
+                    value = phase * S
+                      * internal::screening_B_term( ph1, ph2, Gph, *phc, spms,
+                                                   *cache, *sixj );
                     break;
                 default:
-                    throw invalid_matrix_position(); } } }
-    return m;
+                    throw invalid_matrix_position(); }
+            block.add( i, k, value ); } }
 }
 
 namespace internal {
 
 double screening_A_term( const ParticleHoleState &ph1,
                          const ParticleHoleState &ph2, double E,
-                         const PHInteraction &Gph,
-                         const ParticleHoleModelspace   &phms,
-                         const SingleParticleModelspace &spms ) {
-    typedef ParticleHoleState ph_t;
+                         const PHInteractionTable &Gph,
+                         const StateChannels            &phc,
+                         const SingleParticleModelspace &spms,
+                         IntermediateCache &cache,
+                         const Wigner6jTable &sixj ) {
+    return evaluate( screening_A_poles( ph1, ph2, Gph, phc, spms,
+                                        cache, sixj ), E ); }
 
+PoleSum screening_A_poles( const ParticleHoleState &ph1,
+                           const ParticleHoleState &ph2,
+                           const PHInteractionTable &Gph,
+                           const StateChannels            &phc,
+                           const SingleParticleModelspace &spms,
+                           IntermediateCache &cache,
+                           const Wigner6jTable &sixj ) {
     // Shell indicies
     int ia = ph1.ip;
     int ib = ph1.ih;
     int ic = ph2.ip;
     int id = ph2.ih;
 
-    // Fragment indicies
-    int iaf = ph1.ipf;
-    int ibf = ph1.ihf;
-    int icf = ph2.ipf;
-    int idf = ph2.ihf;
-
     // Useful items
     int J      = ph1.J;
-    int tz     = boost::numeric_cast<int>(spms.tz[ia] - spms.tz[ic]);
-    int parity = spms.parity[ia] * spms.parity[ic];
 
     // Quick asserts
     assert( ph1.J == ph2.J );
@@ -100,69 +113,106 @@ double screening_A_term( const ParticleHoleState &ph1,
     int Jpmin = std::max( std::abs( spms.j[ia] - spms.j[ic] ),
                           std::abs( spms.j[ib] - spms.j[id] ) );
     int Jpmax = std::min( spms.j[ia] + spms.j[ic], spms.j[ib] + spms.j[id] );
-    assert( Jpmax < boost::numeric_cast<int>(phms[1+tz][(parity+1)/2].size()) );
-    assert( Jpmax < boost::numeric_cast<int>(phms[1-tz][(parity+1)/2].size()) );
 
-    double result = 0;
+    PoleSum result;
     for ( int Jp = Jpmin; Jp <= Jpmax; ++Jp ) {
-        ph_t left(  ia, ic, -1, -1, Jp );
-        ph_t right( ib, id, -1, -1, Jp );
-        double JpTerm = 0;
-//        assert( 0 != phms[1 + tz][(parity+1)/2][Jp].size() );
-        BOOST_FOREACH(ph_t i_ph, phms[1 + tz][(parity+1)/2][Jp]) {
-            double Si_ph = spms.pfrag[i_ph.ip][i_ph.ipf].S
-                         * spms.hfrag[i_ph.ih][i_ph.ihf].S;
-            // Forward going terms
-            JpTerm += Si_ph *
-                Gph( left, i_ph ) * Gph( i_ph, right ) /
-                ( E - ( spms.pfrag[ic][icf].E - spms.hfrag[ib][ibf].E
-                        + spms.pfrag[ i_ph.ip ][ i_ph.ipf ].E
-                        - spms.hfrag[ i_ph.ih ][ i_ph.ihf ].E ) );
-        }
-//        assert( 0 != phms[1 - tz][(parity+1)/2][Jp].size() );
-        BOOST_FOREACH(ph_t i_ph, phms[1 - tz][(parity+1)/2][Jp] ) {
-            double Si_ph = spms.pfrag[i_ph.ip][i_ph.ipf].S
-                         * spms.hfrag[i_ph.ih][i_ph.ihf].S;
-            // Backward going terms
-            ph_t r_ph( i_ph.ih, i_ph.ip, -1, -1, Jp );
-            JpTerm += Si_ph *
-                Gph( left, r_ph ) * Gph( r_ph, right ) /
-                ( E - ( spms.pfrag[ia][iaf].E - spms.hfrag[id][idf].E
-                        + spms.pfrag[ i_ph.ip ][ i_ph.ipf ].E
-                        - spms.hfrag[ i_ph.ih ][ i_ph.ihf ].E ) );
-        }
-        result -= JpTerm * std::pow( -1.0, spms.j[ib] + spms.j[ic] + J + Jp )
-                * (  2 * Jp + 1 )
-                * wigner6j( spms.j[ia], spms.j[ib], J,
+        double coef = - std::pow( -1.0, spms.j[ib] + spms.j[ic] + J + Jp )
+                    * (  2 * Jp + 1 )
+                    * sixj( spms.j[ia], spms.j[ib], J,
                             spms.j[id], spms.j[ic], Jp );
+        if ( 0 == coef )
+            continue;
+        IntermediateKey key( ia, ib, ic, id,
+                             ph1.ipf, ph1.ihf, ph2.ipf, ph2.ihf, Jp );
+        add( result, screening_A_intermediate( key, find_screening_shell(
+                        key, Gph, phc, spms, cache ), spms ), coef );
+    }
+    compress( result );
+    return result;
+}
+
+ShellIntermediate screening_shell_intermediate(
+                                  const IntermediateKey &key,
+                                  const PHInteractionTable &Gph,
+                                  const StateChannels            &phc,
+                                  const SingleParticleModelspace &spms ) {
+    int tz     = boost::numeric_cast<int>(spms.tz[key.a] - spms.tz[key.c]);
+    int parity = spms.parity[key.a] * spms.parity[key.c];
+    assert( key.Jp < phc.num_J(  tz, parity ) );
+    assert( key.Jp < phc.num_J( -tz, parity ) );
+
+    // The reversed backward states are in the same channel as left.  The
+    // products G( a, c, i ) * G( i, b, d ) for every intermediate shell pair
+    // i of the channel are one elementwise product of two dense rows, as
+    // G( i, b, d ) = G( b, d, i ).
+    PHInteractionTable::Channel G = Gph.channel( tz, parity, key.Jp );
+    const double *left  = G.row( key.a, key.c );
+    const double *right = G.row( key.b, key.d );
+    std::vector< double > GG( G.dimension() );
+    for ( int n = 0; n < G.dimension(); ++n ) {
+        GG[n] = left[n] * right[n]; }
+
+    ShellIntermediate result;
+    int end = phc.end( tz, parity, key.Jp );
+    result.forward.poles.reserve( end - phc.begin( tz, parity, key.Jp ) );
+    for ( int n = phc.begin( tz, parity, key.Jp ); n < end; ++n ) {
+        // Forward going terms
+        add_pole( result.forward,
+                  phc.S[n] * GG[ G.position( phc.i1[n], phc.i2[n] ) ],
+                  phc.E[n] );
     }
+    end = phc.end( -tz, parity, key.Jp );
+    result.backward.poles.reserve( end - phc.begin( -tz, parity, key.Jp ) );
+    for ( int n = phc.begin( -tz, parity, key.Jp ); n < end; ++n ) {
+        // Backward going terms
+        add_pole( result.backward,
+                  phc.S[n] * GG[ G.position( phc.i2[n], phc.i1[n] ) ],
+                  phc.E[n] );
+    }
+    compress( result.forward );
+    compress( result.backward );
+    return result;
+}
+
+const ShellIntermediate &find_screening_shell(
+                                  const IntermediateKey &key,
+                                  const PHInteractionTable &Gph,
+                                  const StateChannels            &phc,
+                                  const SingleParticleModelspace &spms,
+                                  IntermediateCache &cache ) {
+    IntermediateKey shells = key.shells();
+    const ShellIntermediate *shell = cache.find_shell( shells );
+    if ( !shell )
+        shell = &cache.insert_shell( shells,
+                screening_shell_intermediate( shells, Gph, phc, spms ) );
+    return *shell; }
+
+PoleSum screening_A_intermediate( const IntermediateKey &key,
+                                  const ShellIntermediate &shell,
+                                  const SingleParticleModelspace &spms ) {
+    PoleSum result = shift( shell.forward,
+            spms.pfrag[key.c][key.cf].E - spms.hfrag[key.b][key.bf].E );
+    add( result, shift( shell.backward,
+            spms.pfrag[key.a][key.af].E - spms.hfrag[key.d][key.df].E ) );
+    compress( result );
     return result;
 }
 
 double screening_B_term( const ParticleHoleState &ph1,
                          const ParticleHoleState &ph2,
-                         const PHInteraction &Gph,
-                         const ParticleHoleModelspace   &phms,
-                         const SingleParticleModelspace &spms ) {
-    typedef ParticleHoleState ph_t;
-
+                         const PHInteractionTable &Gph,
+                         const StateChannels            &phc,
+                         const SingleParticleModelspace &spms,
+                         IntermediateCache &cache,
+                         const Wigner6jTable &sixj ) {
     // Shell indicies
     int ia = ph1.ip;
     int ib = ph1.ih;
     int ic = ph2.ih;
     int id = ph2.ip;
 
-    // Fragment indicies
-    // NOTE: c is now a hole fragment, and d a particle fragment
-    int iaf = ph1.ipf;
-    int ibf = ph1.ihf;
-    int icf = ph2.ihf;
-    int idf = ph2.ipf;
-
     // Useful items
     int J      = ph1.J;
-    int tz     = boost::numeric_cast<int>(spms.tz[ia] - spms.tz[ic]);
-    int parity = spms.parity[ia] * spms.parity[ic];
 
     // Quick asserts
     assert( ph1.J == ph2.J );
@@ -173,49 +223,42 @@ double screening_B_term( const ParticleHoleState &ph1,
     int Jpmin = std::max( std::abs( spms.j[ia] - spms.j[ic] ),
                           std::abs( spms.j[ib] - spms.j[id] ) );
     int Jpmax = std::min( spms.j[ia] + spms.j[ic], spms.j[ib] + spms.j[id] );
-    assert( Jpmax < boost::numeric_cast<int>(phms[1+tz][(parity+1)/2].size()) );
 
     double result = 0;
     for ( int Jp = Jpmin; Jp <= Jpmax; ++Jp ) {
-        ph_t left(  ia, ic, -1, -1, Jp );
-        ph_t right( ib, id, -1, -1, Jp );
-        double JpTerm = 0;
-        BOOST_FOREACH(ph_t i_ph, phms[1 + tz][(parity+1)/2][Jp]) {
-            double Si_ph = spms.pfrag[i_ph.ip][i_ph.ipf].S
-                         * spms.hfrag[i_ph.ih][i_ph.ihf].S;
-            // Forward going terms
-            JpTerm += Si_ph *
-                Gph( left, i_ph ) * Gph( i_ph, right ) /
-                - ( spms.pfrag[id][idf].E - spms.hfrag[ib][ibf].E
-                    + spms.pfrag[ i_ph.ip ][ i_ph.ipf ].E
-                    - spms.hfrag[ i_ph.ih ][ i_ph.ihf ].E );
-        }
-        BOOST_FOREACH(ph_t i_ph, phms[1 - tz][(parity+1)/2][Jp] ) {
-            double Si_ph = spms.pfrag[i_ph.ip][i_ph.ipf].S
-                         * spms.hfrag[i_ph.ih][i_ph.ihf].S;
-            // Backward going terms
-            ph_t r_ph( i_ph.ih, i_ph.ip, -1, -1, Jp );
-            JpTerm += Si_ph *
-                Gph( left, r_ph ) * Gph( r_ph, right ) /
-                - ( spms.pfrag[ia][iaf].E - spms.hfrag[ic][icf].E
-                    + spms.pfrag[ i_ph.ip ][ i_ph.ipf ].E
-                    - spms.hfrag[ i_ph.ih ][ i_ph.ihf ].E );
-        }
+        // NOTE: c is now a hole fragment, and d a particle fragment
+        IntermediateKey key( ia, ib, ic, id,
+                             ph1.ipf, ph1.ihf, ph2.ihf, ph2.ipf, Jp );
+        double JpTerm = screening_B_intermediate( key, find_screening_shell(
+                    key, Gph, phc, spms, cache ), spms );
         result -= JpTerm * std::pow( -1.0, spms.j[ib] + spms.j[ic] + J + Jp )
                 * (  2 * Jp + 1 )
-                * wigner6j( spms.j[ia], spms.j[ib], J,
-                            spms.j[id], spms.j[ic], Jp );
+                * sixj( spms.j[ia], spms.j[ib], J,
+                        spms.j[id], spms.j[ic], Jp );
     }
     return result;
 }
 
+// NOTE: c is a hole fragment, and d a particle fragment
+double screening_B_intermediate( const IntermediateKey &key,
+                                 const ShellIntermediate &shell,
+                                 const SingleParticleModelspace &spms ) {
+    return evaluate( shell.forward,
+              - ( spms.pfrag[key.d][key.df].E - spms.hfrag[key.b][key.bf].E ) )
+         + evaluate( shell.backward,
+              - ( spms.pfrag[key.a][key.af].E - spms.hfrag[key.c][key.cf].E ) );
+}
+
 } // end namespace internal
 
 Term make_screening( const PHInteraction &Gph,
-                     const ParticleHoleModelspace   &phms,
-                     const SingleParticleModelspace &spms ) {
-    return boost::bind( screening, _1, _2, _3, boost::cref(Gph),
-            boost::cref(phms), boost::cref(spms) );
+                     boost::shared_ptr< const StateChannels > phc,
+                     const SingleParticleModelspace &spms,
+                     boost::shared_ptr< const Wigner6jTable > sixj ) {
+    boost::shared_ptr< IntermediateCache > cache( new IntermediateCache );
+    return boost::bind( screening, _1, _2, _3,
+            as_ph_table( Gph, spms ), phc, boost::cref(spms), cache,
+            sixj );
 }
 
 } // end namespace terms
@@ -1,36 +1,80 @@
 #ifndef _RPA_TERMS_SCREENING_H_
 #define _RPA_TERMS_SCREENING_H_
 
+#include <boost/shared_ptr.hpp>
+
 #include "linalg.h"
 
 #include "Interaction.h"
+#include "InteractionTable.h"
 #include "Modelspace.h"
 
+#include "PoleTable.h"
+#include "IntermediateCache.h"
+#include "angular_momentum.h"
 #include "Term.h"
 
 namespace terms {
 
-util::matrix_t
+void
 screening( const std::vector< ParticleHoleState > &vec, double E,
-           position_t pos, const PHInteraction &Gph,
-           const SingleParticleModelspace &spms );
+           TermBlock &block,
+           const PHInteractionTable &Gph,
+           boost::shared_ptr< const StateChannels > phc,
+           const SingleParticleModelspace &spms,
+           boost::shared_ptr< IntermediateCache > cache,
+           boost::shared_ptr< const Wigner6jTable > sixj );
 
+// The intermediate sums are shared by every J, and are stored in cache.
 namespace internal {
 double screening_A_term( const ParticleHoleState &ph1,
                          const ParticleHoleState &ph2, double E,
-                         const PHInteraction &Gph,
-                         const ParticleHoleModelspace   &phms,
-                         const SingleParticleModelspace &spms );
+                         const PHInteractionTable &Gph,
+                         const StateChannels            &phc,
+                         const SingleParticleModelspace &spms,
+                         IntermediateCache &cache,
+                         const Wigner6jTable &sixj );
+PoleSum screening_A_poles( const ParticleHoleState &ph1,
+                           const ParticleHoleState &ph2,
+                           const PHInteractionTable &Gph,
+                           const StateChannels            &phc,
+                           const SingleParticleModelspace &spms,
+                           IntermediateCache &cache,
+                           const Wigner6jTable &sixj );
 double screening_B_term( const ParticleHoleState &ph1,
                          const ParticleHoleState &ph2,
-                         const PHInteraction &Gph,
-                         const ParticleHoleModelspace   &phms,
-                         const SingleParticleModelspace &spms );
+                         const PHInteractionTable &Gph,
+                         const StateChannels            &phc,
+                         const SingleParticleModelspace &spms,
+                         IntermediateCache &cache,
+                         const Wigner6jTable &sixj );
+
+// Sums over intermediate states for a single Jp, without the recoupling
+// coefficient.  The shell sums hold the interaction products; the others
+// add the energies of the external fragments.
+ShellIntermediate screening_shell_intermediate(
+                                  const IntermediateKey &key,
+                                  const PHInteractionTable &Gph,
+                                  const StateChannels            &phc,
+                                  const SingleParticleModelspace &spms );
+const ShellIntermediate &find_screening_shell(
+                                  const IntermediateKey &key,
+                                  const PHInteractionTable &Gph,
+                                  const StateChannels            &phc,
+                                  const SingleParticleModelspace &spms,
+                                  IntermediateCache &cache );
+PoleSum screening_A_intermediate( const IntermediateKey &key,
+                                  const ShellIntermediate &shell,
+                                  const SingleParticleModelspace &spms );
+double screening_B_intermediate( const IntermediateKey &key,
+                                 const ShellIntermediate &shell,
+                                 const SingleParticleModelspace &spms );
 } // end namespace internal
 
 Term make_screening( const PHInteraction &Gph,
-                     const ParticleHoleModelspace   &phms,
-                     const SingleParticleModelspace &spms );
+                     boost::shared_ptr< const StateChannels > phc,
+                     const SingleParticleModelspace &spms,
+                     boost::shared_ptr< const Wigner6jTable > sixj );
 
 } // end namespace terms
 
@@ -4,201 +4,227 @@
 #include <boost/foreach.hpp>
 #include <boost/bind.hpp>
 #include <boost/numeric/conversion/cast.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/locks.hpp>
 
 #include "linalg.h"
 
 #include "Interaction.h"
+#include "InteractionTable.h"
 #include "Modelspace.h"
 
+#include "PoleTable.h"
 #include "Term.h"
 #include "exceptions.h"
 
 #include "self_energy.h"
+#include "pp_interaction_factories.h"
+#include "modelspace_factories.h"
 
 namespace terms {
 
-util::matrix_t
+// --------------------------------------------------------------------
+// SelfEnergyLines
+// --------------------------------------------------------------------
+
+SelfEnergyLines::SelfEnergyLines(
+        const PPInteractionTable &nGpp,
+        boost::shared_ptr< const StateChannels > nppc,
+        boost::shared_ptr< const StateChannels > nhhc,
+        const SEModelspace &nsems,
+        const SingleParticleModelspace &nspms )
+    : Gpp( nGpp ), ppc( nppc ), hhc( nhhc ), sems( nsems ),
+      spms( nspms ) { }
+
+PoleSum SelfEnergyLines::poles( const ParticleHoleState &ph ) {
+    PoleSum result = shift( particle_line( ph.ip, ph.ipf ),
+                            - spms.hfrag[ph.ih][ph.ihf].E );
+    add( result, shift( hole_line( ph.ih, ph.ihf ),
+                        spms.pfrag[ph.ip][ph.ipf].E ) );
+    compress( result );
+    return result; }
+
+// The lines are summed outside of the lock; a line summed twice by
+// different threads is only stored once.
+const PoleSum &SelfEnergyLines::particle_line( int ia, int iaf ) {
+    fragment_t key( ia, iaf );
+    {   boost::lock_guard< boost::mutex > lock( mutex );
+        std::map< fragment_t, PoleSum >::const_iterator i
+            = particle_lines.find( key );
+        if ( particle_lines.end() != i )
+            return i->second; }
+    PoleSum line = internal::SE_particle_poles( ia, iaf, Gpp,
+            *ppc, *hhc, sems, spms );
+    boost::lock_guard< boost::mutex > lock( mutex );
+    return particle_lines.insert( std::make_pair( key, line ) ).first->second; }
+
+const PoleSum &SelfEnergyLines::hole_line( int ib, int ibf ) {
+    fragment_t key( ib, ibf );
+    {   boost::lock_guard< boost::mutex > lock( mutex );
+        std::map< fragment_t, PoleSum >::const_iterator i
+            = hole_lines.find( key );
+        if ( hole_lines.end() != i )
+            return i->second; }
+    PoleSum line = internal::SE_hole_poles( ib, ibf, Gpp,
+            *ppc, *hhc, sems, spms );
+    boost::lock_guard< boost::mutex > lock( mutex );
+    return hole_lines.insert( std::make_pair( key, line ) ).first->second; }
+
+// --------------------------------------------------------------------
+// Terms
+// --------------------------------------------------------------------
+
+void
 self_energy( const std::vector< ParticleHoleState > &vec, double E,
-             position_t pos, const PPInteraction &Gpp,
-             const ParticleParticleModelspace &ppms,
-             const ParticleParticleModelspace &hhms,
-             const SEModelspace               &sems,
-             const SingleParticleModelspace &spms ) {
+             TermBlock &block,
+             boost::shared_ptr< SelfEnergyLines > lines ) {
     int size = vec.size();
-    util::matrix_t m( size, size );
-    m.clear();
 
-    if ( ENUM_B == pos or ENUM_B_STAR == pos )
-        return m;
+    if ( ENUM_B == block.pos or ENUM_B_STAR == block.pos )
+        return;
 
     // self energy terms show up only on the diagonal (of course)
     for ( int i=0; i < size; ++i ) {
-        ParticleHoleState ph = vec[i];
-
-        switch ( pos ) {
+        switch ( block.pos ) {
             case ENUM_A:
-                m( i, i ) = internal::SE_particle_line( ph, E, Gpp,
-                        ppms, hhms, sems, spms )
-                    + internal::SE_hole_line( ph, E, Gpp,
-                        ppms, hhms, sems, spms );
+                block.add( i, i, evaluate( lines->poles( vec[i] ), E ) );
                 break;
             case ENUM_A_STAR:
                 // A_STAR phase is always 1 on the diagonal
-                m( i, i ) = internal::SE_particle_line( ph, -E, Gpp,
-                        ppms, hhms, sems, spms )
-                    + internal::SE_hole_line( ph, -E, Gpp,
-                        ppms, hhms, sems, spms );
+                block.add( i, i, evaluate( lines->poles( vec[i] ), -E ) );
                 break;
             default:
                 throw invalid_matrix_position();
         }
     }
-
-    return m;
 }
 
 namespace internal {
 
-double SE_particle_line( const ParticleHoleState &ph, double E,
-                         const PPInteraction &Gpp,
-                         const ParticleParticleModelspace &ppms,
-                         const ParticleParticleModelspace &hhms,
-                         const SEModelspace &sems,
-                         const SingleParticleModelspace &spms ) {
-    typedef ParticleParticleState pp_t;
-
-    // Shell indicies
-    int ia = ph.ip;
-    int ib = ph.ih;
+// Both lines sum over a left state of the SE modelspace and the states of
+// its channel, with the channel of the interaction looked up once per left
+// state.
 
-    // Fragment indicies
-    int iaf = ph.ipf;
-    int ibf = ph.ihf;
+PoleSum SE_particle_poles( int ia, int iaf,
+                           const PPInteractionTable &Gpp,
+                           const StateChannels &ppc,
+                           const StateChannels &hhc,
+                           const SEModelspace &sems,
+                           const SingleParticleModelspace &spms ) {
+    typedef ParticleParticleState pp_t;
 
     int Jpmin = 0;
     int Jpmax = boost::numeric_cast<int>( spms.maxj + spms.j[ia] );
-    double result = 0;
+    PoleSum result;
     for ( int Jp = Jpmin; Jp <= Jpmax; ++Jp ) {
-        double JpTerm = 0;
+        double coef = ( 2 * Jp + 1 ) / ( 4 * spms.j[ia] + 2 );
         // make list of outter left side states
         // loop over outter left states
 //        assert( 0 != sems.ph[Jp][ia][iaf].size() );
         if ( Jp < boost::numeric_cast<int>(sems.ph.size()) ) {
-            BOOST_FOREACH( pp_t left, sems.ph[Jp][ia][iaf] ) {
-            //      make list of inner right side states
+            BOOST_FOREACH( const pp_t &left, sems.ph[Jp][ia][iaf] ) {
             //      loop over inner right side states
                 int tz =
                     boost::numeric_cast<int>(spms.tz[left.ip1]
                             + spms.tz[left.ip2]);
                 int parity = spms.parity[left.ip1] * spms.parity[left.ip2];
-                if ( Jp >= boost::numeric_cast<int>(
-                            ppms[1+tz][(parity+1)/2].size()) )
+                if ( Jp >= ppc.num_J( tz, parity ) )
                     continue;
-                BOOST_FOREACH( pp_t right, ppms[1+tz][(parity+1)/2][Jp] ) {
+                PPInteractionTable::Channel G = Gpp.channel( tz, parity, Jp );
+                double E_left = spms.hfrag[left.ip2][left.ip2f].E;
+                int end = ppc.end( tz, parity, Jp );
+                for ( int n = ppc.begin( tz, parity, Jp ); n < end; ++n ) {
             //      add contribution
-                    JpTerm += std::pow( Gpp( left, right ), 2 ) /
-                        ( E - (   spms.pfrag[right.ip1][right.ip1f].E
-                                + spms.pfrag[right.ip2][right.ip2f].E
-                                - spms.hfrag[ib][ibf].E
-                                - spms.hfrag[left.ip2][left.ip2f].E ) ); } } }
+                    double g = G( left.ip1, left.ip2, ppc.i1[n], ppc.i2[n] );
+                    add_pole( result, coef * g * g, ppc.E[n] - E_left ); } } }
         //  make list of outter right side states
         //  loop over outter right states
         if ( Jp < boost::numeric_cast<int>(sems.pp.size()) ) {
-            BOOST_FOREACH( pp_t left, sems.pp[Jp][ia][iaf] ) {
-            //      make inner left states
+            BOOST_FOREACH( const pp_t &left, sems.pp[Jp][ia][iaf] ) {
             //      loop over inner left states
                 int tz =
                     boost::numeric_cast<int>(spms.tz[left.ip1]
                             + spms.tz[left.ip2]);
                 int parity = spms.parity[left.ip1] * spms.parity[left.ip2];
-                if ( Jp >= boost::numeric_cast<int>(
-                        hhms[1+tz][(parity+1)/2].size()) )
+                if ( Jp >= hhc.num_J( tz, parity ) )
                     continue;
-                BOOST_FOREACH( pp_t right, hhms[1+tz][(parity+1)/2][Jp] ) {
-            //      add contribution
-                    JpTerm += std::pow( Gpp( left, right ), 2 ) /
-                        ( spms.pfrag[ia][iaf].E - (
-                              spms.hfrag[right.ip1][right.ip1f].E
-                            + spms.hfrag[right.ip2][right.ip2f].E
-                            - spms.pfrag[left.ip2][left.ip2f].E ) ); } } }
-
-        result += JpTerm * ( 2 * Jp + 1 ); }
-    return result / ( 4 * spms.j[ia] + 2 ); }
-
-double SE_hole_line    ( const ParticleHoleState &ph, double E,
-                         const PPInteraction &Gpp,
-                         const ParticleParticleModelspace &ppms,
-                         const ParticleParticleModelspace &hhms,
-                         const SEModelspace &sems,
-                         const SingleParticleModelspace &spms ) {
+                PPInteractionTable::Channel G = Gpp.channel( tz, parity, Jp );
+                double E_left = spms.pfrag[left.ip2][left.ip2f].E;
+                int end = hhc.end( tz, parity, Jp );
+                for ( int n = hhc.begin( tz, parity, Jp ); n < end; ++n ) {
+            //      add contribution (energy independent)
+                    double g = G( left.ip1, left.ip2, hhc.i1[n], hhc.i2[n] );
+                    result.constant += coef * g * g /
+                        ( spms.pfrag[ia][iaf].E - ( hhc.E[n] - E_left ) );
+                } } } }
+    compress( result );
+    return result; }
+
+PoleSum SE_hole_poles    ( int ib, int ibf,
+                           const PPInteractionTable &Gpp,
+                           const StateChannels &ppc,
+                           const StateChannels &hhc,
+                           const SEModelspace &sems,
+                           const SingleParticleModelspace &spms ) {
     typedef ParticleParticleState pp_t;
-    // Shell indicies
-    int ia = ph.ip;
-    int ib = ph.ih;
-
-    // Fragment indicies
-    int iaf = ph.ipf;
-    int ibf = ph.ihf;
 
     int Jpmin = 0;
     int Jpmax = boost::numeric_cast<int>( spms.maxj + spms.j[ib] );
-    double result = 0;
+    PoleSum result;
     for ( int Jp = Jpmin; Jp <= Jpmax; ++Jp ) {
-        double JpTerm = 0;
+        double coef = ( 2 * Jp + 1 ) / ( 4 * spms.j[ib] + 2 );
         // make list of outter left side states
         // loop over outter left states
         if ( Jp < boost::numeric_cast<int>(sems.hh.size()) ) {
-            BOOST_FOREACH( pp_t left, sems.hh[Jp][ib][ibf] ) {
-            //      make list of inner right side states
+            BOOST_FOREACH( const pp_t &left, sems.hh[Jp][ib][ibf] ) {
             //      loop over inner right side states
                 int tz =
                     boost::numeric_cast<int>( spms.tz[left.ip1]
                                             + spms.tz[left.ip2] );
                 int parity = spms.parity[left.ip1] * spms.parity[left.ip2];
-                if ( Jp >= boost::numeric_cast<int>(
-                            ppms[1+tz][(parity+1)/2].size()) )
+                if ( Jp >= ppc.num_J( tz, parity ) )
                     continue;
-                BOOST_FOREACH( pp_t right, ppms[1+tz][(parity+1)/2][Jp] ) {
-            //      add contribution
-                    JpTerm -= std::pow( Gpp( left, right ), 2 ) /
-                        ( spms.hfrag[ib][ibf].E - (
-                              spms.pfrag[right.ip1][right.ip1f].E
-                            + spms.pfrag[right.ip2][right.ip2f].E
-                            - spms.hfrag[left.ip2][left.ip2f].E ) ); } } }
+                PPInteractionTable::Channel G = Gpp.channel( tz, parity, Jp );
+                double E_left = spms.hfrag[left.ip2][left.ip2f].E;
+                int end = ppc.end( tz, parity, Jp );
+                for ( int n = ppc.begin( tz, parity, Jp ); n < end; ++n ) {
+            //      add contribution (energy independent)
+                    double g = G( left.ip1, left.ip2, ppc.i1[n], ppc.i2[n] );
+                    result.constant -= coef * g * g /
+                        ( spms.hfrag[ib][ibf].E - ( ppc.E[n] - E_left ) );
+                } } }
         //  make list of outter right side states
         //  loop over outter right states
 //        assert( 0 != sems.hp[Jp][ib][ibf].size() );
         if ( Jp < boost::numeric_cast<int>(sems.hp.size()) ) {
-            BOOST_FOREACH( pp_t left, sems.hp[Jp][ib][ibf] ) {
-            //      make inner left states
+            BOOST_FOREACH( const pp_t &left, sems.hp[Jp][ib][ibf] ) {
             //      loop over inner left states
                 int tz =
                     boost::numeric_cast<int>(spms.tz[left.ip1]
                             + spms.tz[left.ip2]);
                 int parity = spms.parity[left.ip1] * spms.parity[left.ip2];
-                if ( Jp >= boost::numeric_cast<int>(
-                            hhms[1+tz][(parity+1)/2].size()) )
+                if ( Jp >= hhc.num_J( tz, parity ) )
                     continue;
-                BOOST_FOREACH( pp_t right, hhms[1+tz][(parity+1)/2][Jp] ) {
+                PPInteractionTable::Channel G = Gpp.channel( tz, parity, Jp );
+                double E_left = spms.pfrag[left.ip2][left.ip2f].E;
+                int end = hhc.end( tz, parity, Jp );
+                for ( int n = hhc.begin( tz, parity, Jp ); n < end; ++n ) {
             //      add contribution
-                    JpTerm += std::pow( Gpp( left, right ), 2 ) /
-                        ( E - (   spms.pfrag[ia][iaf].E
-                                + spms.pfrag[left.ip2][left.ip2f].E
-                                - spms.hfrag[right.ip1][right.ip1f].E
-                                - spms.hfrag[right.ip2][right.ip2f].E ) ); } } }
-        result += JpTerm * ( 2 * Jp + 1 ); }
-    return result / ( 4 * spms.j[ib] + 2 ); }
+                    double g = G( left.ip1, left.ip2, hhc.i1[n], hhc.i2[n] );
+                    add_pole( result, coef * g * g, E_left - hhc.E[n] ); } } } }
+    compress( result );
+    return result; }
 
 } // end namespace internal
 
 Term make_self_energy( const PPInteraction &Gpp,
-                       const ParticleParticleModelspace &ppms,
-                       const ParticleParticleModelspace &hhms,
+                       boost::shared_ptr< const StateChannels > ppc,
+                       boost::shared_ptr< const StateChannels > hhc,
                        const SEModelspace &sems,
                        const SingleParticleModelspace &spms ) {
-    return boost::bind( self_energy, _1, _2, _3, boost::cref(Gpp),
-            boost::cref(ppms), boost::cref(hhms), boost::cref(sems),
-            boost::cref(spms) );
+    boost::shared_ptr< SelfEnergyLines > lines( new SelfEnergyLines(
+                as_pp_table( Gpp, spms ), ppc, hhc, sems, spms ) );
+    return boost::bind( self_energy, _1, _2, _3, lines );
 }
 
 } // end namespace terms
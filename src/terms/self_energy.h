@@ -1,45 +1,85 @@
 #ifndef _RPA_TERMS_SELF_ENERGY_H_
 #define _RPA_TERMS_SELF_ENERGY_H_
 
+#include <map>
+#include <utility>
+
 #include <boost/foreach.hpp>
 #include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
 
 #include "linalg.h"
 
 #include "Interaction.h"
+#include "InteractionTable.h"
 #include "Modelspace.h"
 
+#include "PoleTable.h"
 #include "Term.h"
 
 namespace terms {
 
-util::matrix_t
-self_energy( const std::vector< ParticleHoleState > &vec, double E,
-             position_t pos, const PPInteraction &Gpp,
-             const ParticleParticleModelspace &ppms,
-             const ParticleParticleModelspace &hhms,
-             const SEModelspace &sems,
-             const SingleParticleModelspace &spms );
+// The particle and hole lines of the self energy.  The particle line of a
+// ph state depends only on the particle fragment, up to a shift of its poles
+// by the energy of the hole fragment, and the other way around for the hole
+// line.  Each line is summed once per fragment and shared by every channel.
+// May be shared by threads; stored lines are never changed.
+class SelfEnergyLines {
+    public:
+        // sems and spms are owned by the caller.
+        SelfEnergyLines( const PPInteractionTable &nGpp,
+                         boost::shared_ptr< const StateChannels > nppc,
+                         boost::shared_ptr< const StateChannels > nhhc,
+                         const SEModelspace &nsems,
+                         const SingleParticleModelspace &nspms );
+
+        // Both lines of ph.
+        PoleSum poles( const ParticleHoleState &ph );
+    private:
+        typedef std::pair< int, int > fragment_t;
+
+        const PoleSum &particle_line( int ia, int iaf );
+        const PoleSum &hole_line( int ib, int ibf );
 
+        PPInteractionTable                      Gpp;
+        boost::shared_ptr< const StateChannels > ppc;
+        boost::shared_ptr< const StateChannels > hhc;
+        const SEModelspace                     &sems;
+        const SingleParticleModelspace         &spms;
+
+        boost::mutex                            mutex;
+        std::map< fragment_t, PoleSum >         particle_lines;
+        std::map< fragment_t, PoleSum >         hole_lines;
+};
+
+void
+self_energy( const std::vector< ParticleHoleState > &vec, double E,
+             TermBlock &block,
+             boost::shared_ptr< SelfEnergyLines > lines );
 
 namespace internal {
-double SE_particle_line( const ParticleHoleState &ph, double E,
-                         const PPInteraction &Gpp,
-                         const ParticleParticleModelspace &ppms,
-                         const ParticleParticleModelspace &hhms,
-                         const SEModelspace &sems,
-                         const SingleParticleModelspace &spms );
-double SE_hole_line    ( const ParticleHoleState &ph, double E,
-                         const PPInteraction &Gpp,
-                         const ParticleParticleModelspace &ppms,
-                         const ParticleParticleModelspace &hhms,
-                         const SEModelspace &sems,
-                         const SingleParticleModelspace &spms );
+// The particle line of fragment ( ia, iaf ) without the energy of the hole
+// fragment, which only shifts the poles down.
+PoleSum SE_particle_poles( int ia, int iaf,
+                           const PPInteractionTable &Gpp,
+                           const StateChannels &ppc,
+                           const StateChannels &hhc,
+                           const SEModelspace &sems,
+                           const SingleParticleModelspace &spms );
+// The hole line of fragment ( ib, ibf ) without the energy of the particle
+// fragment, which only shifts the poles up.
+PoleSum SE_hole_poles    ( int ib, int ibf,
+                           const PPInteractionTable &Gpp,
+                           const StateChannels &ppc,
+                           const StateChannels &hhc,
+                           const SEModelspace &sems,
+                           const SingleParticleModelspace &spms );
 } // end namespace internal
 
 Term make_self_energy( const PPInteraction &Gpp,
-                       const ParticleParticleModelspace &ppms,
-                       const ParticleParticleModelspace &hhms,
+                       boost::shared_ptr< const StateChannels > ppc,
+                       boost::shared_ptr< const StateChannels > hhc,
                        const SEModelspace &sems,
                        const SingleParticleModelspace &spms );
 
@@ -0,0 +1,38 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <cmath>
+
+#include "linalg.h"
+#include "PoleTable.h"
+#include "ChebyshevTable.h"
+
+// Poles a fair distance outside [ 1, 2 ] are fitted to rounding error.
+TEST( ChebyshevTable, FarPoles ) {
+    PoleTable table( 2 );
+    table( 0, 0 ).constant = 0.5;
+    add_pole( table( 0, 0 ),  1.0, -1.0 );
+    add_pole( table( 0, 1 ),  0.3,  2.8 );
+    add_pole( table( 0, 1 ), -2.0,  0.2 );
+    add_pole( table( 1, 1 ),  0.7,  3.5 );
+    table.compress();
+
+    ChebyshevTable fit( table, 1, 2, 30 );
+    EXPECT_EQ( 2, fit.dimension() );
+    for ( double E = 1; E <= 2; E += 0.0625 ) {
+        util::matrix_t exact( 2, 2 ), fitted( 2, 2 );
+        exact.clear();
+        fitted.clear();
+        table.evaluate( E, exact );
+        fit.evaluate( E, fitted );
+        util::matrix_t exact_slope( 2, 2 ), fitted_slope( 2, 2 );
+        exact_slope.clear();
+        fitted_slope.clear();
+        table.evaluate_derivative( E, exact_slope );
+        fit.evaluate_derivative( E, fitted_slope );
+        for ( int i = 0; i < 2; ++i ) {
+            for ( int k = 0; k < 2; ++k ) {
+                EXPECT_NEAR( exact( i, k ), fitted( i, k ), 1e-10 );
+                EXPECT_NEAR( exact_slope( i, k ), fitted_slope( i, k ),
+                             1e-8 ); } } }
+}
@@ -0,0 +1,42 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "EigenvalueCache.h"
+
+TEST( EigenvalueCache, FindInsert ) {
+    EigenvalueCache cache;
+    std::vector< double > vals;
+    EXPECT_EQ( 0, cache.hit_rate() );
+    EXPECT_FALSE( cache.find( 1.5, vals ) );
+
+    std::vector< double > stored( 3 );
+    stored[0] = -1;
+    stored[1] =  2;
+    stored[2] =  4;
+    cache.insert( 1.5, stored );
+    ASSERT_TRUE( cache.find( 1.5, vals ) );
+    EXPECT_EQ( stored, vals );
+    EXPECT_FALSE( cache.find( 1.5 + 1e-12, vals ) );
+
+    // Only the insert counts as a miss
+    EXPECT_EQ( 1, cache.hits() );
+    EXPECT_EQ( 1, cache.misses() );
+    EXPECT_DOUBLE_EQ( 0.5, cache.hit_rate() );
+    EXPECT_EQ( 1, cache.size() );
+}
+
+// The energy used least recently is dropped first.
+TEST( EigenvalueCache, Capacity ) {
+    EigenvalueCache cache( 2 );
+    std::vector< double > vals( 1, 0.0 );
+    cache.insert( 1, vals );
+    cache.insert( 2, vals );
+    EXPECT_TRUE( cache.find( 1, vals ) );
+    cache.insert( 3, vals );
+
+    EXPECT_EQ( 2, cache.size() );
+    EXPECT_TRUE( cache.find( 1, vals ) );
+    EXPECT_FALSE( cache.find( 2, vals ) );
+    EXPECT_TRUE( cache.find( 3, vals ) );
+}
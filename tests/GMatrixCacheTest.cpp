@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <fstream>
+
+#include <boost/foreach.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "Modelspace.h"
+#include "Interaction.h"
+#include "GMatrixCache.h"
+#include "modelspace_factories.h"
+#include "pp_interaction_factories.h"
+
+void copy_file( const std::string &from, const std::string &to ) {
+    std::ifstream in( from.c_str(), std::ios::binary );
+    std::ofstream out( to.c_str(), std::ios::binary );
+    out << in.rdbuf(); }
+
+TEST( GMatrixCache, PackedGMatrix ) {
+    Indexsizes sizes( 3, std::vector< std::vector< int > >( 2 ) );
+    sizes[1][1].push_back( 2 );
+    sizes[1][1].push_back( 3 );
+    sizes[2][0].push_back( 1 );
+
+    PackedGMatrix G( sizes );
+    G.set( 0,  1, 1, 2, 0, 1.5 );
+    G.set( 1, -1, 0, 0, 0, 2.5 );
+    EXPECT_DOUBLE_EQ( 1.5, G( 0,  1, 1, 0, 2 ) );
+    EXPECT_DOUBLE_EQ( 2.5, G( 1, -1, 0, 0, 0 ) );
+    EXPECT_DOUBLE_EQ( 0.0, G( 0,  1, 1, 1, 2 ) );
+    EXPECT_FALSE( G.is_mapped() );
+
+    GMatrixKey key = { 10, 20, 30 };
+    std::string filename = "gmatrix_cache_test.cache";
+    ASSERT_TRUE( G.write_file( filename, key ) );
+
+    boost::shared_ptr< const PackedGMatrix > mapped
+        = PackedGMatrix::map_file( filename, key, sizes );
+    ASSERT_TRUE( mapped );
+    EXPECT_TRUE( mapped->is_mapped() );
+    EXPECT_DOUBLE_EQ( 1.5, (*mapped)( 0,  1, 1, 0, 2 ) );
+    EXPECT_DOUBLE_EQ( 2.5, (*mapped)( 1, -1, 0, 0, 0 ) );
+
+    // Stale keys and different channel sizes are rejected
+    GMatrixKey other = key;
+    other.source_mtime = 21;
+    EXPECT_FALSE( PackedGMatrix::map_file( filename, other, sizes ) );
+    other = key;
+    other.modelspace_hash = 31;
+    EXPECT_FALSE( PackedGMatrix::map_file( filename, other, sizes ) );
+    sizes[2][0][0] = 2;
+    EXPECT_FALSE( PackedGMatrix::map_file( filename, key, sizes ) );
+    EXPECT_FALSE( PackedGMatrix::map_file( "missing.cache", key, sizes ) );
+
+    std::remove( filename.c_str() );
+}
+
+// Interactions read through the cache must match the parsed file.
+TEST( GMatrixCache, Interaction ) {
+    std::string filename = "gmatrix_cache_test.mhj";
+    std::string cache_filename = get_gmatrix_cache_filename( filename );
+    copy_file( "tests/data/test_interaction.mhj", filename );
+    std::remove( cache_filename.c_str() );
+
+    SingleParticleModelspace spms =
+        read_sp_modelspace_from_file( "tests/data/ipm_modelspace.dat" );
+    ParticleParticleModelspace ppms = build_pp_modelspace_from_sp( spms );
+    PPInteraction parsed = build_gmatrix_from_mhj_file( filename, spms, false );
+    EXPECT_FALSE( std::ifstream( cache_filename.c_str() ) );
+
+    PPInteraction first  = build_gmatrix_from_mhj_file( filename, spms, true );
+    EXPECT_TRUE( std::ifstream( cache_filename.c_str() ) );
+    GMatrixKey key = make_gmatrix_key( filename, spms );
+    Indexsizes sizes = build_ppindices( spms ).get<1>();
+    boost::shared_ptr< const PackedGMatrix > cached
+        = PackedGMatrix::map_file( cache_filename, key, sizes );
+    ASSERT_TRUE( cached );
+    EXPECT_TRUE( cached->is_mapped() );
+    PPInteraction second = build_gmatrix_from_mhj_file( filename, spms, true );
+
+    for ( int tz = -1; tz <= 1; ++tz ) {
+        for ( int parity = -1; parity <= 1; parity += 2 ) {
+            const std::vector< std::vector< ParticleParticleState > > &channels
+                = ppms[tz+1][(parity+1)/2];
+            BOOST_FOREACH( const std::vector< ParticleParticleState > &states,
+                           channels ) {
+                BOOST_FOREACH( const ParticleParticleState &A, states ) {
+                    BOOST_FOREACH( const ParticleParticleState &B, states ) {
+                        EXPECT_EQ( parsed( A, B ), first( A, B ) );
+                        EXPECT_EQ( parsed( A, B ), second( A, B ) ); } } } } }
+
+    // Changing the source invalidates the cache
+    {   std::ofstream out( filename.c_str(), std::ios::app );
+        out << "\n"; }
+    GMatrixKey changed = make_gmatrix_key( filename, spms );
+    EXPECT_NE( key.source_size, changed.source_size );
+    EXPECT_FALSE( PackedGMatrix::map_file( cache_filename, changed, sizes ) );
+
+    std::remove( filename.c_str() );
+    std::remove( cache_filename.c_str() );
+}
@@ -0,0 +1,106 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+
+#include "Modelspace.h"
+#include "Interaction.h"
+#include "InteractionTable.h"
+#include "modelspace_factories.h"
+#include "pp_interaction_factories.h"
+#include "ph_interaction_factories.h"
+
+namespace {
+// Interactions that are not tables, to exercise the tabulation.
+double scaled_pp( const PPInteraction &G, double scale,
+                  const ParticleParticleState &A,
+                  const ParticleParticleState &B ) {
+    return scale * G( A, B ); }
+
+double scaled_ph( const PHInteraction &G, double scale,
+                  const ParticleHoleState &A,
+                  const ParticleHoleState &B ) {
+    return scale * G( A, B ); }
+} // end anonymous namespace
+
+TEST( InteractionTable, PPChannel ) {
+    SingleParticleModelspace spms =
+        read_sp_modelspace_from_file( "tests/data/ipm_modelspace.dat" );
+    PPInteractionTable Gpp = build_gmatrix_table_from_mhj_file(
+            "tests/data/test_interaction.mhj", spms );
+
+    typedef ParticleParticleState pp_t;
+
+    // Includes phase changes (see pp_interaction_factoriesTest.cpp)
+    EXPECT_FLOAT_EQ(  2.074107922,
+            Gpp( pp_t( 11, 1, -1, -1, 1 ), pp_t( 8, 11, -1, -1, 1 ) ) );
+    EXPECT_FLOAT_EQ( -0.008798113,
+            Gpp( pp_t( 5, 0, -1, -1, 1 ), pp_t( 1, 7, -1, -1, 1 ) ) );
+
+    int tz     = spms.tz[ 5 ]     + spms.tz[ 0 ];
+    int parity = spms.parity[ 5 ] * spms.parity[ 0 ];
+    PPInteractionTable::Channel G = Gpp.channel( tz, parity, 1 );
+    EXPECT_EQ( Gpp( pp_t( 5, 0, -1, -1, 1 ), pp_t( 1, 7, -1, -1, 1 ) ),
+               G( 5, 0, 1, 7 ) );
+    EXPECT_EQ( Gpp( pp_t( 0, 5, -1, -1, 1 ), pp_t( 7, 1, -1, -1, 1 ) ),
+               G( 0, 5, 7, 1 ) );
+
+    std::vector< double > row;
+    G.row( 5, 0, row );
+    ASSERT_EQ( G.dimension(), static_cast<int>(row.size()) );
+    EXPECT_EQ( G( 5, 0, 1, 7 ), row[ G.position( 1, 7 ) ] );
+    EXPECT_EQ( G( 5, 0, 0, 5 ), row[ G.position( 0, 5 ) ] );
+
+    // The wrapper hands back the same table
+    PPInteraction wrapped = Gpp;
+    EXPECT_EQ( Gpp( pp_t( 5, 0, -1, -1, 1 ), pp_t( 1, 7, -1, -1, 1 ) ),
+            as_pp_table( wrapped, spms )(
+                pp_t( 5, 0, -1, -1, 1 ), pp_t( 1, 7, -1, -1, 1 ) ) );
+}
+
+TEST( InteractionTable, PPFromFunction ) {
+    SingleParticleModelspace spms =
+        read_sp_modelspace_from_file( "tests/data/ipm_modelspace.dat" );
+    PPInteraction Gpp = build_gmatrix_from_mhj_file(
+            "tests/data/test_interaction.mhj", spms );
+    PPInteractionTable table = as_pp_table(
+            boost::bind( scaled_pp, Gpp, 2.0, _1, _2 ), spms );
+
+    typedef ParticleParticleState pp_t;
+
+    EXPECT_FLOAT_EQ( 2 * Gpp( pp_t( 11, 1, -1, -1, 1 ), pp_t( 8, 11, -1, -1, 1 ) ),
+            table( pp_t( 11, 1, -1, -1, 1 ), pp_t( 8, 11, -1, -1, 1 ) ) );
+    EXPECT_FLOAT_EQ( 2 * Gpp( pp_t( 5, 0, -1, -1, 1 ), pp_t( 7, 1, -1, -1, 1 ) ),
+            table( pp_t( 5, 0, -1, -1, 1 ), pp_t( 7, 1, -1, -1, 1 ) ) );
+    EXPECT_FLOAT_EQ( 2 * Gpp( pp_t( 6, 6, -1, -1, 6 ), pp_t( 6, 8, -1, -1, 6 ) ),
+            table( pp_t( 6, 6, -1, -1, 6 ), pp_t( 6, 8, -1, -1, 6 ) ) );
+}
+
+TEST( InteractionTable, PHFromFunction ) {
+    SingleParticleModelspace spms =
+        read_sp_modelspace_from_file( "tests/data/ipm_modelspace.dat" );
+    ParticleHoleModelspace shells = build_ph_shells_from_sp( spms );
+    PPInteraction Gpp = build_gmatrix_from_mhj_file(
+            "tests/data/test_interaction.mhj", spms );
+    Wigner6jTable sixj( spms.maxj );
+    PHInteractionTable Gph = build_ph_table_from_pp( Gpp, spms, sixj );
+    PHInteractionTable table = as_ph_table(
+            boost::bind( scaled_ph, PHInteraction( Gph ), 2.0, _1, _2 ),
+            spms );
+
+    for ( int tz = -1; tz <= 1; ++tz ) {
+        for ( int parity = -1; parity <= 1; parity += 2 ) {
+            const std::vector< std::vector< ParticleHoleState > > &channels
+                = shells[tz+1][(parity+1)/2];
+            for ( int J = 0; J < static_cast<int>(channels.size()); ++J ) {
+                PHInteractionTable::Channel G = Gph.channel( tz, parity, J );
+                BOOST_FOREACH( const ParticleHoleState &A, channels[J] ) {
+                    BOOST_FOREACH( const ParticleHoleState &B, channels[J] ) {
+                        EXPECT_EQ( Gph( A, B ), G( A.ip, A.ih, B.ip, B.ih ) );
+                        EXPECT_EQ( Gph( A, B ), G.row( A.ip, A.ih )[
+                                        G.position( B.ip, B.ih ) ] );
+                        EXPECT_EQ( 2 * Gph( A, B ), table( A, B ) );
+                    } } } } }
+}
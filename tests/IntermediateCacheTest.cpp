@@ -0,0 +1,60 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "Modelspace.h"
+#include "Interaction.h"
+#include "PoleTable.h"
+#include "IntermediateCache.h"
+#include "Term.h"
+
+#include "test_problem.h"
+
+TEST( IntermediateCache, FindInsert ) {
+    IntermediateCache cache;
+    IntermediateKey key( 0, 1, 2, 3, 0, 0, 1, 0, 2 );
+    IntermediateKey other( 0, 1, 2, 3, 0, 0, 1, 0, 3 );
+    EXPECT_TRUE( key < other );
+    EXPECT_FALSE( other < key );
+
+    IntermediateKey shells = key.shells();
+    EXPECT_EQ( -1, shells.cf );
+    EXPECT_EQ( 2, shells.Jp );
+    EXPECT_EQ( 0, cache.find_shell( shells ) );
+    ShellIntermediate sums;
+    add_pole( sums.backward, 0.5, -1.0 );
+    cache.insert_shell( shells, sums );
+    ASSERT_TRUE( cache.find_shell( shells ) );
+    EXPECT_DOUBLE_EQ( -1.0, cache.find_shell( shells )->backward.poles[0].E );
+    EXPECT_EQ( 0, cache.find_shell( key ) );
+    EXPECT_EQ( 1, cache.size() );
+}
+
+// Terms sharing a cache across J must agree with fresh terms.
+TEST( IntermediateCache, SharedAcrossJ ) {
+    TestProblem p( "tests/data/ipm_modelspace.dat" );
+    std::vector< PoleTerm > shared = p.pole_terms();
+    int tz     = 0;
+    int parity = 1;
+    for ( int J = 0; J <= 3; ++J ) {
+        const std::vector< ParticleHoleState > &ph_states
+            = p.phms[tz+1][(parity+1)/2][J];
+        std::vector< PoleTerm > fresh = p.pole_terms();
+        for ( unsigned int t = 0; t < shared.size(); ++t ) {
+            util::matrix_t a( ph_states.size(), ph_states.size() );
+            util::matrix_t b( ph_states.size(), ph_states.size() );
+            a.clear();
+            b.clear();
+            PoleTable shared_A( ph_states.size() );
+            PoleTable shared_A_star( ph_states.size() );
+            PoleTable fresh_A( ph_states.size() );
+            PoleTable fresh_A_star( ph_states.size() );
+            shared[t]( ph_states, shared_A, shared_A_star );
+            fresh[t]( ph_states, fresh_A, fresh_A_star );
+            shared_A.evaluate( 1.3, a );
+            fresh_A.evaluate( 1.3, b );
+            for ( unsigned int i = 0; i < a.size1(); ++i ) {
+                for ( unsigned int k = 0; k < a.size2(); ++k ) {
+                    EXPECT_NEAR( b( i, k ), a( i, k ), 1e-12 )
+                        << "J = " << J; } } } }
+}
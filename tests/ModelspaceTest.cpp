@@ -22,3 +22,21 @@ TEST( Modelspace, Poles ) {
     EXPECT_FLOAT_EQ( 42.420139, poles[3] );
 }
 */
+
+// Every asymptote is the energy of at least one counted 2p2h state.
+TEST( Modelspace, Count2p2hStates ) {
+    SingleParticleModelspace spms =
+        read_sp_modelspace_from_file( "tests/data/ipm_modelspace.dat" );
+    ParticleParticleModelspace ppms = build_pp_modelspace_from_sp( spms );
+    ParticleParticleModelspace hhms = build_hh_modelspace_from_sp( spms );
+    StateChannels ppc = build_pp_channels( ppms, spms );
+    StateChannels hhc = build_hh_channels( hhms, spms );
+
+    for ( int parity = -1; parity <= 1; parity += 2 ) {
+        for ( int J = 0; J <= 3; ++J ) {
+            int count = count_2p2h_states( 0, parity, J, ppc, hhc );
+            EXPECT_LT( 0, count );
+            EXPECT_LE( static_cast<int>( get_erpa_asymptotes(
+                            0, parity, J, ppms, hhms, spms ).size() ),
+                       count ); } }
+}
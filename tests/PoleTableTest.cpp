@@ -0,0 +1,254 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <cmath>
+
+#include "linalg.h"
+
+#include "Modelspace.h"
+#include "Interaction.h"
+#include "PoleTable.h"
+#include "Term.h"
+#include "MatrixFactory.h"
+
+#include "term_factories.h"
+#include "test_problem.h"
+
+TEST( PoleTable, PoleSum ) {
+    PoleSum s;
+    s.constant = 1;
+    add_pole( s,  2.0,  3.0 );
+    add_pole( s, -1.0, -2.0 );
+    add_pole( s,  0.5,  3.0 );
+
+    EXPECT_DOUBLE_EQ( 1 + 2.5 / ( 1 - 3.0 ) - 1 / ( 1 + 2.0 ),
+                      evaluate( s, 1 ) );
+    EXPECT_DOUBLE_EQ( evaluate( s, -4.5 ), evaluate( reflect( s ), 4.5 ) );
+    EXPECT_DOUBLE_EQ( evaluate( s, 0.5 ), evaluate( shift( s, 1.25 ), 1.75 ) );
+    EXPECT_DOUBLE_EQ( -2.5 / ( ( 1 - 3.0 ) * ( 1 - 3.0 ) )
+                      + 1 / ( ( 1 + 2.0 ) * ( 1 + 2.0 ) ),
+                      evaluate_derivative( s, 1 ) );
+
+    double before = evaluate( s, 0.25 );
+    compress( s );
+    EXPECT_EQ( 2, s.poles.size() );
+    EXPECT_DOUBLE_EQ( -2.0, s.poles[0].E );
+    EXPECT_DOUBLE_EQ(  2.5, s.poles[1].R );
+    EXPECT_DOUBLE_EQ( before, evaluate( s, 0.25 ) );
+
+    // Poles without residue are removed
+    add_pole( s,  1.0,  7.0 );
+    add_pole( s, -1.0,  7.0 );
+    compress( s );
+    EXPECT_EQ( 2, s.poles.size() );
+}
+
+TEST( PoleTable, Asymptotes ) {
+    std::vector< Pole > poles;
+    poles.push_back( Pole(  1.0,  4.0 ) );
+    poles.push_back( Pole(  2.0, -1.0 ) );
+    poles.push_back( Pole( -1.0,  1.0 ) );
+    poles.push_back( Pole(  0.5,  1.0 + 1e-6 ) );
+    poles.push_back( Pole(  1e-15, 2.0 ) );
+    poles.push_back( Pole(  1.0,  3.0 ) );
+    poles.push_back( Pole(  1.0,  5.0 ) );
+
+    // Not above Emin, close to 1.0, without residue, past the first above 3.5
+    std::vector< double > a = pole_asymptotes( poles, 0, 3.5, 1e-3 );
+    ASSERT_EQ( 3, a.size() );
+    EXPECT_EQ( 1.0, a[0] );
+    EXPECT_EQ( 3.0, a[1] );
+    EXPECT_EQ( 4.0, a[2] );
+
+    EXPECT_TRUE( pole_asymptotes( std::vector< Pole >(), 0, 1, 0 ).empty() );
+}
+
+TEST( PoleTable, Evaluate ) {
+    PoleTable table( 3 );
+    add_pole( table( 0, 0 ), 1.0, 2.0 );
+    add_pole( table( 2, 1 ), 3.0, 1.0 );
+    table( 1, 2 ).constant = 1;
+
+    util::matrix_t m( 3, 3 );
+    m.clear();
+    table.evaluate( 0, m );
+
+    EXPECT_DOUBLE_EQ( -0.5, m( 0, 0 ) );
+    EXPECT_DOUBLE_EQ( -2.0, m( 1, 2 ) );
+    EXPECT_DOUBLE_EQ( -2.0, m( 2, 1 ) );
+    EXPECT_DOUBLE_EQ(  0.0, m( 0, 2 ) );
+    EXPECT_EQ( 2, table.num_poles() );
+
+    std::vector< Pole > poles;
+    table.collect_poles( poles );
+    ASSERT_EQ( 2, poles.size() );
+    EXPECT_EQ( 2.0, poles[0].E );
+    EXPECT_EQ( 1.0, poles[1].E );
+
+    // Packed by compress, unpacked again by a change
+    table.compress();
+    m.clear();
+    table.evaluate( 0, m );
+    EXPECT_DOUBLE_EQ( -0.5, m( 0, 0 ) );
+    EXPECT_DOUBLE_EQ( -2.0, m( 1, 2 ) );
+
+    add_pole( table( 0, 0 ), 2.0, -1.0 );
+    m.clear();
+    table.evaluate( 0, m );
+    EXPECT_DOUBLE_EQ( 1.5, m( 0, 0 ) );
+
+    // Several energies at once, packed and not
+    std::vector< double > energies;
+    energies.push_back( 0.0 );
+    energies.push_back( 0.5 );
+    energies.push_back( 4.0 );
+    for ( int pass = 0; pass < 2; ++pass ) {
+        if ( 1 == pass )
+            table.compress();
+        std::vector< util::matrix_t > ms( energies.size(),
+                                          util::matrix_t( 3, 3 ) );
+        for ( unsigned int e = 0; e < energies.size(); ++e ) {
+            ms[e].clear(); }
+        table.evaluate( energies, ms );
+        for ( unsigned int e = 0; e < energies.size(); ++e ) {
+            m.clear();
+            table.evaluate( energies[e], m );
+            for ( int i = 0; i < 3; ++i ) {
+                for ( int k = 0; k < 3; ++k ) {
+                    EXPECT_DOUBLE_EQ( m( i, k ), ms[e]( i, k ) ); } } } }
+}
+
+TEST( PoleTable, Split ) {
+    PoleTable table( 2 );
+    table( 0, 1 ).constant = 2;
+    add_pole( table( 0, 1 ), 1.0, 0.5 );
+    add_pole( table( 0, 1 ), 1.0, 1.5 );
+    add_pole( table( 1, 1 ), 1.0, 3.0 );
+
+    PoleTable inside, outside;
+    table.split( 1, 2, inside, outside );
+    EXPECT_EQ( 1, inside.num_poles() );
+    EXPECT_EQ( 2, outside.num_poles() );
+    EXPECT_DOUBLE_EQ( 2, inside( 0, 1 ).constant );
+    EXPECT_DOUBLE_EQ( 0, outside( 0, 1 ).constant );
+
+    // The parts add up to the table
+    util::matrix_t whole( 2, 2 ), parts( 2, 2 );
+    whole.clear();
+    parts.clear();
+    table.evaluate( 1.25, whole );
+    inside.evaluate( 1.25, parts );
+    outside.evaluate( 1.25, parts );
+    EXPECT_DOUBLE_EQ( whole( 0, 1 ), parts( 0, 1 ) );
+    EXPECT_DOUBLE_EQ( whole( 1, 1 ), parts( 1, 1 ) );
+}
+
+// The tabulated dynamic terms must reproduce the direct calculation.
+TEST( PoleTable, MatrixFactory ) {
+    TestProblem p( "tests/data/frag_modelspace.dat" );
+    std::vector< Term >     static_terms  = p.static_terms();
+    std::vector< Term >     dynamic_terms = p.dynamic_terms();
+    std::vector< PoleTerm > pole_terms    = p.pole_terms();
+
+    int tz     =  0;
+    int parity =  1;
+    int J      =  0;
+    const std::vector< ParticleHoleState > &ph_states
+        = p.phms[tz+1][(parity+1)/2][J];
+    util::matrix_t static_matrix
+        = build_static_erpa_matrix( static_terms, dynamic_terms, ph_states );
+
+    MatrixFactory direct( static_matrix, dynamic_terms, ph_states,
+                          J, parity, tz );
+    MatrixFactory tabulated( static_matrix, pole_terms, ph_states,
+                             J, parity, tz );
+
+    double energies[] = { -3.7, 0.5, 4.25 };
+    for ( int e = 0; e < 3; ++e ) {
+        util::matrix_t a = direct.build( energies[e] );
+        util::matrix_t b = tabulated.build( energies[e] );
+        for ( unsigned int i = 0; i < a.size1(); ++i ) {
+            for ( unsigned int k = 0; k < a.size2(); ++k ) {
+                EXPECT_NEAR( a( i, k ), b( i, k ), 1e-9 )
+                    << "E = " << energies[e]; } } }
+
+    // All energies at once
+    std::vector< double > all( energies, energies + 3 );
+    std::vector< util::matrix_t > batch;
+    tabulated.build( all, batch );
+    ASSERT_EQ( 3, batch.size() );
+    for ( int e = 0; e < 3; ++e ) {
+        util::matrix_t b = tabulated.build( energies[e] );
+        for ( unsigned int i = 0; i < b.size1(); ++i ) {
+            for ( unsigned int k = 0; k < b.size2(); ++k ) {
+                EXPECT_NEAR( b( i, k ), batch[e]( i, k ),
+                             1e-12 * ( 1 + std::abs( b( i, k ) ) ) ); } } }
+    std::vector< std::vector< double > > vals
+        = tabulated.sorted_eigenvalues( all, 2 );
+    for ( int e = 0; e < 3; ++e ) {
+        EXPECT_EQ( util::sorted_eigenvalues( batch[e] ), vals[e] ); }
+    // Without the cache
+    int misses = tabulated.eigenvalue_cache().misses();
+    EXPECT_EQ( vals, tabulated.compute_sorted_eigenvalues( all, 2 ) );
+    EXPECT_EQ( misses, tabulated.eigenvalue_cache().misses() );
+    // Several batches, in one run of the threads
+    std::vector< double > many;
+    for ( int e = 0; e < 40; ++e ) {
+        many.push_back( -4.05 + 0.2 * e ); }
+    std::vector< std::vector< double > > many_vals
+        = tabulated.compute_sorted_eigenvalues( many, 3 );
+    ASSERT_EQ( many.size(), many_vals.size() );
+    for ( unsigned int e = 0; e < many.size(); ++e ) {
+        std::vector< double > expected
+            = util::sorted_eigenvalues( tabulated.build( many[e] ) );
+        ASSERT_EQ( expected.size(), many_vals[e].size() );
+        for ( unsigned int i = 0; i < expected.size(); ++i ) {
+            EXPECT_NEAR( expected[i], many_vals[e][i],
+                         1e-9 * ( 1 + std::abs( expected[i] ) ) ); } }
+
+    // A surrogate on [ 0.25, 0.75 ]
+    MatrixFactory fit = tabulated.surrogate( 0.25, 0.75, 24 );
+    EXPECT_TRUE( fit.is_surrogate() );
+    EXPECT_FALSE( tabulated.is_surrogate() );
+    util::matrix_t a = tabulated.build( 0.5 ), b = fit.build( 0.5 );
+    util::matrix_t da = tabulated.build_derivative( 0.5 ),
+                   db = fit.build_derivative( 0.5 );
+    for ( unsigned int i = 0; i < a.size1(); ++i ) {
+        for ( unsigned int k = 0; k < a.size2(); ++k ) {
+            EXPECT_NEAR( a( i, k ), b( i, k ),
+                         1e-8 * ( 1 + std::abs( a( i, k ) ) ) );
+            EXPECT_NEAR( da( i, k ), db( i, k ),
+                         1e-6 * ( 1 + std::abs( da( i, k ) ) ) ); } }
+
+    // Exact against finite difference derivatives
+    for ( int e = 0; e < 3; ++e ) {
+        util::matrix_t a = direct.build_derivative( energies[e] );
+        util::matrix_t b = tabulated.build_derivative( energies[e] );
+        for ( unsigned int i = 0; i < a.size1(); ++i ) {
+            for ( unsigned int k = 0; k < a.size2(); ++k ) {
+                EXPECT_NEAR( a( i, k ), b( i, k ),
+                             1e-5 * ( 1 + std::abs( b( i, k ) ) ) )
+                    << "E = " << energies[e]; } } }
+}
+
+// The B and B* blocks filled next to the pole tables must match the terms.
+TEST( PoleTable, FusedBTerms ) {
+    TestProblem p( "tests/data/frag_modelspace.dat" );
+    std::vector< Term > static_terms  = p.static_terms();
+    std::vector< Term > dynamic_terms = p.dynamic_terms();
+    std::vector< Term > B_terms;
+    p.pole_terms( B_terms );
+
+    for ( int parity = -1; parity <= 1; parity += 2 ) {
+        const std::vector< ParticleHoleState > &ph_states
+            = p.phms[1][(parity+1)/2][1];
+        util::matrix_t a
+            = build_static_erpa_matrix( static_terms, dynamic_terms,
+                                        ph_states );
+        util::matrix_t b
+            = build_static_erpa_matrix( static_terms, B_terms, ph_states );
+        for ( unsigned int i = 0; i < a.size1(); ++i ) {
+            for ( unsigned int k = 0; k < a.size2(); ++k ) {
+                EXPECT_NEAR( a( i, k ), b( i, k ), 1e-12 )
+                    << "parity = " << parity; } } }
+}
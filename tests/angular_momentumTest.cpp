@@ -138,3 +138,20 @@ TEST(AngularMomentum, Wigner6J) {
     EXPECT_FLOAT_EQ( 0.0690065559342,
             wigner6j( 1.5, 3.5, 2,   3.5, 2.5, 1   ));
 }
+
+TEST(AngularMomentum, Wigner6JTable) {
+    Wigner6jTable table( 3.5 );
+    for ( int a = 0; a <= 7; ++a ) {
+    for ( int b = 0; b <= 7; ++b ) {
+    for ( int c = 0; c <= 14; ++c ) {
+    for ( int A = 0; A <= 7; ++A ) {
+    for ( int B = 0; B <= 7; B += 3 ) {
+    for ( int C = 0; C <= 14; ++C ) {
+        EXPECT_EQ( wigner6j( a/2.0, b/2.0, c/2.0, A/2.0, B/2.0, C/2.0 ),
+                   table(    a/2.0, b/2.0, c/2.0, A/2.0, B/2.0, C/2.0 ) );
+    } } } } } }
+
+    // Outside the table
+    EXPECT_FLOAT_EQ( 0.142857142857, table( 1,   2,   3,   5,   2,   3   ));
+    EXPECT_THROW( table( 1, 1.9, 0.5, 1, 2, 0.5 ), illegal_angular_momentum );
+}
@@ -29,7 +29,8 @@ TEST( DRPA, FunctionalTest ) {
     ParticleHoleModelspace phms = build_ph_modelspace_from_sp( spms );
     PPInteraction Gpp
         = build_gmatrix_from_mhj_file( "tests/data/test_interaction.mhj", spms);
-    PHInteraction Gph = build_ph_interaction_from_pp( Gpp, spms );
+    Wigner6jTable sixj( spms.maxj );
+    PHInteraction Gph = build_ph_interaction_from_pp( Gpp, spms, sixj );
     std::vector< Term > terms = build_rpa_terms( Gph, spms );
 
     // Build some matricies and check some eigenvalues
@@ -1,6 +1,8 @@
 #include <gtest/gtest.h>
 
 #include <cmath>
+#include <limits>
+#include <boost/tuple/tuple.hpp>
 #include <boost/lambda/lambda.hpp>
 #include <boost/lambda/bind.hpp>
 
@@ -27,3 +29,26 @@ TEST(FalsePosition, OutOfBounds) {
     EXPECT_THROW( false_position( _1 * bind((double(*)(double)) exp, _1) - 1,
                                   -1, 0, 1e-10, 200 ), root_finding_error );
 }
+
+boost::tuple< double, double > cubic( double x ) {
+    return boost::make_tuple( x * x * x - 2 * x - 5, 3 * x * x - 2 ); }
+
+// Without a derivative every step is a bisection.
+boost::tuple< double, double > no_slope( double x ) {
+    return boost::make_tuple( x * std::exp( x ) - 1,
+                              std::numeric_limits< double >::quiet_NaN() ); }
+
+TEST(SafeNewton, Success) {
+    EXPECT_FLOAT_EQ( 2.0945515532,
+            safe_newton( cubic, 2, 3, -1, 16, 1e-10, 200 ) );
+    EXPECT_FLOAT_EQ( 2.0945515532,
+            safe_newton( cubic, 3, 2, 16, -1, 1e-10, 200 ) );
+    EXPECT_FLOAT_EQ( 0.5671433083,
+            safe_newton( no_slope, -1, 1, -1 - std::exp( -1.0 ),
+                         std::exp( 1.0 ) - 1, 1e-10, 200 ) );
+}
+
+TEST(SafeNewton, OutOfBounds) {
+    EXPECT_THROW( safe_newton( cubic, 0, 1, -5, -6, 1e-10, 200 ),
+                  root_finding_error );
+}
@@ -0,0 +1,134 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <algorithm>
+
+#include <boost/foreach.hpp>
+#include <boost/tuple/tuple.hpp>
+#include <boost/tuple/tuple_comparison.hpp>
+#include <boost/tuple/tuple_io.hpp>
+
+#include "linalg.h"
+
+#include "Modelspace.h"
+#include "Interaction.h"
+#include "Term.h"
+#include "MatrixFactory.h"
+#include "search.h"
+
+#include "modelspace_factories.h"
+#include "pp_interaction_factories.h"
+#include "ph_interaction_factories.h"
+#include "term_factories.h"
+
+std::vector< double > sorted_real_parts( const util::cvector_t &vals ) {
+    std::vector< double > result;
+    BOOST_FOREACH( const util::complex_t &v, vals ) {
+        result.push_back( v.real() ); }
+    std::sort( result.begin(), result.end() );
+    return result; }
+
+void expect_same_eigenvalues( const util::matrix_t &m ) {
+    std::vector< double > expected
+        = sorted_real_parts( util::eigenvalues( m ) );
+    std::vector< double > actual
+        = sorted_real_parts( util::rpa_eigenvalues( m ) );
+    ASSERT_EQ( expected.size(), actual.size() );
+    for ( unsigned int i = 0; i < expected.size(); ++i ) {
+        EXPECT_NEAR( expected[i], actual[i], 1e-8 ) << i; } }
+
+TEST( Linalg, RPAEigenvalues ) {
+    util::matrix_t m( 4, 4 );
+    m.clear();
+    // A = [[3, 1], [1, 2]], B = [[0.5, 0.2], [0.2, 0.1]]
+    m( 0, 0 ) =  3.0; m( 0, 1 ) =  1.0; m( 1, 0 ) =  1.0; m( 1, 1 ) =  2.0;
+    m( 2, 2 ) = -3.0; m( 2, 3 ) = -1.0; m( 3, 2 ) = -1.0; m( 3, 3 ) = -2.0;
+    m( 2, 0 ) =  0.5; m( 2, 1 ) =  0.2; m( 3, 0 ) =  0.2; m( 3, 1 ) =  0.1;
+    m( 0, 2 ) = -0.5; m( 0, 3 ) = -0.2; m( 1, 2 ) = -0.2; m( 1, 3 ) = -0.1;
+    expect_same_eigenvalues( m );
+
+    // Unstable:  imaginary pair
+    m( 2, 0 ) =  4.0; m( 0, 2 ) = -4.0;
+    expect_same_eigenvalues( m );
+
+    // A* != A
+    m( 2, 0 ) =  0.5; m( 0, 2 ) = -0.5;
+    m( 2, 2 ) = -2.5;
+    expect_same_eigenvalues( m );
+
+    // No RPA structure at all
+    m( 0, 1 ) = 7.0;
+    expect_same_eigenvalues( m );
+}
+
+TEST( Linalg, DRPAEigenvalues ) {
+    SingleParticleModelspace spms
+        = read_sp_modelspace_from_file( "tests/data/ipm_modelspace.dat" );
+    ParticleHoleModelspace phms = build_ph_modelspace_from_sp( spms );
+    PPInteraction Gpp
+        = build_gmatrix_from_mhj_file( "tests/data/test_interaction.mhj", spms);
+    Wigner6jTable sixj( spms.maxj );
+    PHInteraction Gph = build_ph_interaction_from_pp( Gpp, spms, sixj );
+    std::vector< Term > terms = build_rpa_terms( Gph, spms );
+
+    int tz = 0;
+    for ( int parity = -1; parity <= 1; parity += 2 ) {
+        for ( int J = 0; J <= 3; ++J ) {
+            expect_same_eigenvalues( build_static_rpa_matrix( terms,
+                        phms[tz+1][(parity+1)/2][J] ) ); } }
+}
+
+TEST( Linalg, Inertia ) {
+    util::matrix_t m( 3, 3 );
+    m.clear();
+    m( 0, 0 ) = 0; m( 0, 1 ) = 2; m( 1, 0 ) = 2; m( 1, 1 ) = 0;
+    m( 2, 2 ) = -4;
+    EXPECT_EQ( boost::make_tuple( 2, 0, 1 ), util::inertia( m ) );
+
+    m( 2, 2 ) = 0;
+    EXPECT_EQ( boost::make_tuple( 1, 1, 1 ), util::inertia( m ) );
+}
+
+TEST( Linalg, RPACountValues ) {
+    util::matrix_t m( 4, 4 );
+    m.clear();
+    m( 0, 0 ) =  3.0; m( 0, 1 ) =  1.0; m( 1, 0 ) =  1.0; m( 1, 1 ) =  2.0;
+    m( 2, 2 ) = -2.5; m( 2, 3 ) = -1.0; m( 3, 2 ) = -1.0; m( 3, 3 ) = -2.0;
+    m( 2, 0 ) =  0.5; m( 2, 1 ) =  0.2; m( 3, 0 ) =  0.2; m( 3, 1 ) =  0.1;
+    m( 0, 2 ) = -0.5; m( 0, 3 ) = -0.2; m( 1, 2 ) = -0.2; m( 1, 3 ) = -0.1;
+    std::vector< double > vals = util::sorted_eigenvalues( m );
+
+    double energies[] = { -5, -2.2, -1, 0, 0.5, 1.9, 2.6, 10 };
+    for ( int e = 0; e < 8; ++e ) {
+        boost::tuple< int, int > count;
+        ASSERT_TRUE( util::rpa_count_values( m, energies[e], count ) );
+        EXPECT_EQ( split_values( vals, energies[e] ), count )
+            << "E = " << energies[e]; }
+
+    // Not positive definite
+    m( 2, 0 ) =  4.0; m( 0, 2 ) = -4.0;
+    boost::tuple< int, int > count;
+    EXPECT_FALSE( util::rpa_count_values( m, 1, count ) );
+}
+
+TEST( Linalg, SortedEigenvalueSlope ) {
+    // Eigenvalues 2 and 3, only the first one moves along dm
+    util::matrix_t m( 2, 2 ), dm( 2, 2 );
+    m( 0, 0 ) = 3;  m( 0, 1 ) = 1;
+    m( 1, 0 ) = 0;  m( 1, 1 ) = 2;
+    dm.clear();
+    dm( 1, 1 ) = 1;
+
+    double value, slope;
+    ASSERT_TRUE( util::sorted_eigenvalue_slope( m, dm, 0, value, slope ) );
+    EXPECT_DOUBLE_EQ( 2, value );
+    EXPECT_NEAR( 1, slope, 1e-12 );
+    ASSERT_TRUE( util::sorted_eigenvalue_slope( m, dm, 1, value, slope ) );
+    EXPECT_DOUBLE_EQ( 3, value );
+    EXPECT_NEAR( 0, slope, 1e-12 );
+
+    // Complex pair
+    m( 0, 0 ) = 0;  m( 0, 1 ) = -1;
+    m( 1, 0 ) = 1;  m( 1, 1 ) = 0;
+    EXPECT_FALSE( util::sorted_eigenvalue_slope( m, dm, 0, value, slope ) );
+}
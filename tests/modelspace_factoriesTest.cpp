@@ -171,6 +171,48 @@ TEST( ModelspaceFactories, HHModelspace ) {
     EXPECT_EQ(  8, hhms[ -1 + 1 ][ (1 - 1)/2 ][ 2 ].size() );
 }
 
+// The flat copies hold the same states in the same order.
+TEST( ModelspaceFactories, StateChannels ) {
+    SingleParticleModelspace spms
+        = read_sp_modelspace_from_file( "tests/data/frag_modelspace.dat" );
+    ParticleHoleModelspace     phms = build_ph_modelspace_from_sp( spms );
+    ParticleParticleModelspace hhms = build_hh_modelspace_from_sp( spms );
+    StateChannels ph = build_ph_channels( phms, spms );
+    StateChannels hh = build_hh_channels( hhms, spms );
+
+    for ( int tz = -1; tz <= 1; ++tz ) {
+        for ( int parity = -1; parity <= 1; parity += 2 ) {
+            const std::vector< std::vector< ParticleHoleState > > &phc
+                = phms[ tz + 1 ][ (parity + 1)/2 ];
+            ASSERT_EQ( boost::numeric_cast<int>(phc.size()),
+                       ph.num_J( tz, parity ) );
+            for ( int J = 0; J < ph.num_J( tz, parity ); ++J ) {
+                int first = ph.begin( tz, parity, J );
+                ASSERT_EQ( boost::numeric_cast<int>(phc[J].size()),
+                           ph.end( tz, parity, J ) - first );
+                for ( int i = 0; i < boost::numeric_cast<int>(phc[J].size());
+                        ++i ) {
+                    const ParticleHoleState &s = phc[J][i];
+                    int n = first + i;
+                    EXPECT_EQ( s.ip, ph.i1[n] );
+                    EXPECT_EQ( s.ih, ph.i2[n] );
+                    EXPECT_EQ( spms.pfrag[s.ip][s.ipf].E
+                             - spms.hfrag[s.ih][s.ihf].E, ph.E[n] );
+                    EXPECT_EQ( spms.pfrag[s.ip][s.ipf].S
+                             * spms.hfrag[s.ih][s.ihf].S, ph.S[n] ); } }
+            ASSERT_EQ( boost::numeric_cast<int>(
+                        hhms[ tz + 1 ][ (parity + 1)/2 ].size()),
+                       hh.num_J( tz, parity ) ); } }
+
+    // 1- (tz = 0), as in FragmentedPHModelspace
+    EXPECT_EQ( 155, ph.end( 0, -1, 1 ) - ph.begin( 0, -1, 1 ) );
+    const ParticleParticleState &s = hhms[ 0 + 1 ][ 1 ][ 2 ][ 3 ];
+    int n = hh.begin( 0, 1, 2 ) + 3;
+    EXPECT_EQ( s.ip2, hh.i2[n] );
+    EXPECT_EQ( spms.hfrag[s.ip1][s.ip1f].E + spms.hfrag[s.ip2][s.ip2f].E,
+               hh.E[n] );
+}
+
 TEST( ModelspaceFactories, PPSPFromSP ) {
     SingleParticleModelspace spms
         = read_sp_modelspace_from_file( "tests/data/ipm_modelspace.dat" );
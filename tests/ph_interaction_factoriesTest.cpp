@@ -1,10 +1,15 @@
 #include <gtest/gtest.h>
 
+#include <vector>
+
+#include <boost/foreach.hpp>
+
 #include "Modelspace.h"
 #include "Interaction.h"
 #include "modelspace_factories.h"
 #include "pp_interaction_factories.h"
 #include "ph_interaction_factories.h"
+#include "pandya.h"
 
 /* Single particle modelspace map for test interaction file
  * mhj file index - 1 -> my modelspace index
@@ -35,7 +40,8 @@ TEST( InteractionFactories, PHFromPP ) {
         read_sp_modelspace_from_file( "tests/data/ipm_modelspace.dat" );
     PPInteraction Gpp = build_gmatrix_from_mhj_file(
             "tests/data/test_interaction.mhj", spms );
-    PHInteraction Gph = build_ph_interaction_from_pp( Gpp, spms );
+    Wigner6jTable sixj( spms.maxj );
+    PHInteraction Gph = build_ph_interaction_from_pp( Gpp, spms, sixj );
 
     typedef ParticleHoleState ph_t;
 
@@ -83,3 +89,28 @@ TEST( InteractionFactories, PHFromPP ) {
     EXPECT_FLOAT_EQ( -0.43559521,
             Gph( ph_t( 4, 7, -1, -1, 0 ), ph_t( 3, 8, -1, -1, 0 ) ) );
 }
+
+// The channel engine must reproduce the element by element transformation.
+TEST( InteractionFactories, PHFromPPThreaded ) {
+    SingleParticleModelspace spms =
+        read_sp_modelspace_from_file( "tests/data/ipm_modelspace.dat" );
+    ParticleHoleModelspace shells = build_ph_shells_from_sp( spms );
+    PPInteraction Gpp = build_gmatrix_from_mhj_file(
+            "tests/data/test_interaction.mhj", spms );
+    Wigner6jTable sixj( spms.maxj );
+    PHInteraction Gph = build_ph_interaction_from_pp( Gpp, spms, sixj, 4 );
+
+    for ( int tz = -1; tz <= 1; ++tz ) {
+        for ( int parity = -1; parity <= 1; parity += 2 ) {
+            const std::vector< std::vector< ParticleHoleState > > &channels
+                = shells[tz+1][(parity+1)/2];
+            BOOST_FOREACH( const std::vector< ParticleHoleState > &states,
+                           channels ) {
+                for ( unsigned int i = 0; i < states.size(); ++i ) {
+                    for ( unsigned int j = i; j < states.size(); ++j ) {
+                        double expected
+                            = pandya( Gpp, spms, states[j], states[i] );
+                        EXPECT_EQ( expected, Gph( states[i], states[j] ) );
+                        EXPECT_EQ( expected, Gph( states[j], states[i] ) );
+                    } } } } }
+}
@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+#include <boost/foreach.hpp>
+
+#include "rational_sum.h"
+
+namespace {
+// Poles spread over [-5, 5), none at the test energies.
+void make_poles( int n, std::vector< double > &R, std::vector< double > &P ) {
+    R.resize( n );
+    P.resize( n );
+    for ( int k = 0; k < n; ++k ) {
+        R[k] = std::cos( 1.0 + k );
+        P[k] = -5 + 10.0 * k / ( n + 1 ) + 0.0137; } }
+
+double plain_sum( const std::vector< double > &R,
+                  const std::vector< double > &P, double E ) {
+    double result = 0;
+    for ( unsigned int k = 0; k < R.size(); ++k ) {
+        result += R[k] / ( E - P[k] ); }
+    return result; }
+
+double plain_derivative( const std::vector< double > &R,
+                         const std::vector< double > &P, double E ) {
+    double result = 0;
+    for ( unsigned int k = 0; k < R.size(); ++k ) {
+        result -= R[k] / ( ( E - P[k] ) * ( E - P[k] ) ); }
+    return result; }
+} // end anonymous namespace
+
+// Every supported instruction set, for lengths around the vector widths.
+TEST( RationalSum, Kernels ) {
+    std::vector< internal::RationalSumKernels > kernels
+        = internal::supported_rational_sum_kernels();
+    ASSERT_FALSE( kernels.empty() );
+    EXPECT_STREQ( kernels.front().isa, rational_sum_isa() );
+    EXPECT_STREQ( "scalar", kernels.back().isa );
+
+    double energies[] = { 0.0, 0.5, -2.25, 7.0, 1.1 };
+    BOOST_FOREACH( const internal::RationalSumKernels &k, kernels ) {
+        for ( int n = 0; n <= 19; ++n ) {
+            std::vector< double > R, P;
+            make_poles( n, R, P );
+            const double *r = n ? &R[0] : 0;
+            const double *p = n ? &P[0] : 0;
+
+            std::vector< double > batch( 5, 1.0 );
+            k.sums( r, p, n, energies, 5, &batch[0] );
+            for ( int e = 0; e < 5; ++e ) {
+                double E = energies[e];
+                double expected = plain_sum( R, P, E );
+                double tolerance = 1e-13 * ( 1 + std::abs( expected ) );
+                EXPECT_NEAR( expected, k.sum( r, p, n, E ), tolerance )
+                    << k.isa << " n = " << n;
+                EXPECT_NEAR( 1 + expected, batch[e], tolerance )
+                    << k.isa << " n = " << n;
+
+                double slope = plain_derivative( R, P, E );
+                EXPECT_NEAR( slope, k.derivative( r, p, n, E ),
+                             1e-13 * ( 1 + std::abs( slope ) ) )
+                    << k.isa << " n = " << n; } } }
+}
@@ -0,0 +1,58 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <cmath>
+#include <iterator>
+
+#include <boost/bind.hpp>
+
+#include "sampling.h"
+
+// Two "eigenvalues":  a straight line and, when with_pole, a pole at 0.3.
+std::vector< std::vector< double > >
+test_values( const std::vector< double > &E, bool with_pole, int &calls ) {
+    ++calls;
+    std::vector< std::vector< double > > result;
+    for ( unsigned int e = 0; e < E.size(); ++e ) {
+        std::vector< double > vals;
+        vals.push_back( 2 * E[e] - 1 );
+        if ( with_pole )
+            vals.push_back( 0.1 / ( E[e] - 0.3 ) );
+        result.push_back( vals ); }
+    return result; }
+
+int count_between( const EigenvalueSamples &samples, double a, double b ) {
+    return std::distance( samples.lower_bound( a ), samples.upper_bound( b ) ); }
+
+// Straight lines only need the grid and one check per interval.
+TEST( Sampling, Smooth ) {
+    int calls = 0;
+    EigenvalueSamples samples = sample_eigenvalues(
+            boost::bind( test_values, _1, false, boost::ref( calls ) ),
+            -1, 1, 0.1, 0.001, 1e-6 );
+    EXPECT_EQ( 41, samples.size() );
+    EXPECT_EQ( 2, calls );
+    EXPECT_DOUBLE_EQ( -1, samples.begin()->first );
+    EXPECT_DOUBLE_EQ(  1, samples.rbegin()->first );
+    EXPECT_DOUBLE_EQ( -3, samples.begin()->second[0] );
+}
+
+// Points gather at the pole, down to half of min_step apart.
+TEST( Sampling, Pole ) {
+    int calls = 0;
+    EigenvalueSamples samples = sample_eigenvalues(
+            boost::bind( test_values, _1, true, boost::ref( calls ) ),
+            -1, 1, 0.1, 0.001, 1e-3 );
+    EXPECT_LT( 4 * count_between( samples, -0.9, -0.7 ),
+               count_between( samples, 0.2, 0.4 ) );
+    EXPECT_GT( 2000u / 4, samples.size() );
+
+    double smallest = 1;
+    for ( EigenvalueSamples::const_iterator i = samples.begin(),
+            next = ++samples.begin(); samples.end() != next; ++i, ++next ) {
+        smallest = std::min( smallest, next->first - i->first ); }
+    EXPECT_LE( 0.0005 - 1e-12, smallest );
+    EXPECT_GT( 0.001, smallest );
+    // One call per round of refinement
+    EXPECT_GT( 10, calls );
+}
@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <stdexcept>
+
+#include <boost/bind.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+
+#include "scheduler.h"
+
+std::vector< double > square_channel( int index ) {
+    return std::vector< double >( index % 3 + 1, index * index ); }
+
+std::vector< double > failing_channel( int index ) {
+    if ( 5 == index )
+        throw std::runtime_error( "channel failed" );
+    return std::vector< double >(); }
+
+void record_channel( std::vector< int > &order,
+                     std::vector< std::vector< double > > &results,
+                     int index, const std::vector< double > &vals ) {
+    order.push_back( index );
+    results.push_back( vals ); }
+
+TEST( Scheduler, RunChannels ) {
+    std::vector< double > costs;
+    for ( int i = 0; i < 20; ++i ) {
+        costs.push_back( ( i * 7 ) % 11 ); }
+
+    for ( int threads = 1; threads <= 4; threads += 3 ) {
+        std::vector< int >                   order;
+        std::vector< std::vector< double > > results;
+        run_channels( costs, square_channel,
+                      boost::bind( record_channel, boost::ref( order ),
+                                   boost::ref( results ), _1, _2 ),
+                      threads );
+
+        // Written in channel order, whatever order they were solved in
+        ASSERT_EQ( 20, order.size() );
+        for ( int i = 0; i < 20; ++i ) {
+            EXPECT_EQ( i, order[i] );
+            EXPECT_EQ( square_channel( i ), results[i] ); } }
+}
+
+TEST( Scheduler, Exception ) {
+    std::vector< double > costs( 10, 1.0 );
+    std::vector< int >                   order;
+    std::vector< std::vector< double > > results;
+    EXPECT_THROW( run_channels( costs, failing_channel,
+                      boost::bind( record_channel, boost::ref( order ),
+                                   boost::ref( results ), _1, _2 ),
+                      4 ),
+                  std::runtime_error );
+    EXPECT_GE( 5, order.size() );
+}
+
+TEST( Scheduler, EstimateChannelCost ) {
+    EXPECT_LT( estimate_channel_cost( 10, 4 ), estimate_channel_cost( 20, 4 ) );
+    EXPECT_LT( estimate_channel_cost( 10, 4 ), estimate_channel_cost( 10, 8 ) );
+}
+
+// Splits [lower, upper) down to single numbers and adds them up.
+void sum_range( TaskPool &pool, boost::mutex &mutex, long &sum,
+                int lower, int upper ) {
+    if ( upper - lower == 1 ) {
+        boost::lock_guard< boost::mutex > lock( mutex );
+        sum += lower;
+        return; }
+    int center = ( lower + upper ) / 2;
+    pool.submit( boost::bind( sum_range, boost::ref( pool ),
+                boost::ref( mutex ), boost::ref( sum ), lower, center ) );
+    pool.submit( boost::bind( sum_range, boost::ref( pool ),
+                boost::ref( mutex ), boost::ref( sum ), center, upper ) ); }
+
+void fail_task() {
+    throw std::runtime_error( "task failed" ); }
+
+TEST( Scheduler, TaskPool ) {
+    for ( int threads = 1; threads <= 4; threads += 3 ) {
+        TaskPool     pool( threads );
+        boost::mutex mutex;
+        long         sum = 0;
+        pool.submit( boost::bind( sum_range, boost::ref( pool ),
+                    boost::ref( mutex ), boost::ref( sum ), 0, 1000 ) );
+        pool.run();
+        EXPECT_EQ( 999 * 1000 / 2, sum );
+
+        // The same pool runs again
+        sum = 0;
+        pool.submit( boost::bind( sum_range, boost::ref( pool ),
+                    boost::ref( mutex ), boost::ref( sum ), 0, 100 ) );
+        pool.run();
+        EXPECT_EQ( 99 * 100 / 2, sum ); }
+
+    TaskPool pool( 4 );
+    pool.submit( fail_task );
+    EXPECT_THROW( pool.run(), std::runtime_error );
+}
@@ -1,12 +1,21 @@
 #include <gtest/gtest.h>
 
 #include <vector>
+#include <cmath>
+#include <algorithm>
+#include <boost/foreach.hpp>
 #include <boost/tuple/tuple.hpp>
 #include <boost/tuple/tuple_comparison.hpp>
 #include <boost/tuple/tuple_io.hpp>
 #include <boost/assign/list_of.hpp>
 
+#include "linalg.h"
+#include "Modelspace.h"
+#include "Interaction.h"
+#include "MatrixFactory.h"
+#include "term_factories.h"
 #include "search.h"
+#include "test_problem.h"
 
 TEST( Search, SplitValues ) {
     typedef boost::tuple< int, int > tup_t;
@@ -38,3 +47,208 @@ TEST( Search, GetNumSolutions ) {
     EXPECT_EQ( 0, get_num_solutions( left_vals,  11,
                                      right_vals, 12 ) );
 }
+
+// The ERPA problem for one channel of the ipm test modelspace, and its
+// asymptotes below 10 as erpa finds them.
+MatrixFactory build_test_channel( int J, int parity,
+                                  std::vector< double > &asymptotes ) {
+    TestProblem p( "tests/data/ipm_modelspace.dat" );
+    std::vector< Term > B_terms;
+    std::vector< PoleTerm > pole_terms = p.pole_terms( B_terms );
+
+    int tz = 0;
+    const std::vector< ParticleHoleState > &ph_states
+        = p.phms[tz+1][(parity+1)/2][J];
+    MatrixFactory mf(
+            build_static_erpa_matrix( p.static_terms(), B_terms, ph_states ),
+            pole_terms, ph_states, J, parity, tz );
+    asymptotes = mf.asymptotes( 10, 0.0001 );
+    return mf; }
+
+// Solving the regions on several threads must give the serial roots.
+TEST( Search, ParallelRegions ) {
+    std::vector< double > asymptotes;
+    MatrixFactory mf = build_test_channel( 1, -1, asymptotes );
+
+    std::vector< double > serial
+        = solve_derpa_eigenvalues( 10, mf, asymptotes );
+    std::vector< double > parallel
+        = solve_derpa_eigenvalues( 10, mf, asymptotes, 0.0001, 4 );
+    EXPECT_FALSE( serial.empty() );
+    EXPECT_EQ( serial, parallel );
+}
+
+// Whether E is a real eigenvalue of mf.build( E ).
+bool is_real_root( const MatrixFactory &mf, double E, double tolerance ) {
+    BOOST_FOREACH( const util::complex_t &v,
+                   util::eigenvalues( mf.build( E ) ) ) {
+        if ( std::abs( v - E ) < tolerance )
+            return true; }
+    return false; }
+
+// Both solvers on one channel below 10.  Every root of the linearized
+// problem must be a real eigenvalue of build( E ), and every root the
+// search returns must be among them.  The roots the search misses must come
+// in pairs between the same asymptotes; returns how many there are.
+int compare_linearized( int J, int parity ) {
+    std::vector< double > asymptotes;
+    MatrixFactory mf = build_test_channel( J, parity, asymptotes );
+    EXPECT_GE( mf.linearized_size_bound(),
+               static_cast<int>(mf.build_linearized().size1()) );
+    std::vector< double > searched
+        = solve_derpa_eigenvalues( 10, mf, asymptotes );
+    std::vector< double > linearized
+        = solve_linearized_eigenvalues( 10, mf, asymptotes );
+
+    BOOST_FOREACH( double E, linearized ) {
+        EXPECT_TRUE( is_real_root( mf, E, 1e-6 ) ) << "E = " << E; }
+    std::vector< bool > found( linearized.size(), false );
+    BOOST_FOREACH( double E, searched ) {
+        std::vector< double >::const_iterator next = std::lower_bound(
+                linearized.begin(), linearized.end(), E - 1e-6 );
+        if ( linearized.end() != next && *next - E < 1e-6 )
+            found[ next - linearized.begin() ] = true;
+        else
+            ADD_FAILURE() << "E = " << E << " is not a linearized root"; }
+
+    // Number of missed roots below each asymptote
+    std::vector< int > missed( asymptotes.size() + 1, 0 );
+    int num_missed = 0;
+    for ( unsigned int i = 0; i < linearized.size(); ++i ) {
+        if ( found[i] )
+            continue;
+        ++missed[ std::upper_bound( asymptotes.begin(), asymptotes.end(),
+                                    linearized[i] ) - asymptotes.begin() ];
+        ++num_missed; }
+    BOOST_FOREACH( int n, missed ) {
+        EXPECT_EQ( 0, n % 2 ); }
+    return num_missed; }
+
+// The linearized problem finds the roots of the search, and more.  Channels
+// small enough for a dense linearized solve in a unit test.
+TEST( Search, Linearized ) {
+    EXPECT_EQ( 0, compare_linearized( 0,  1 ) );
+    EXPECT_EQ( 0, compare_linearized( 6,  1 ) );
+    EXPECT_EQ( 0, compare_linearized( 5, -1 ) );
+    EXPECT_EQ( 0, compare_linearized( 6, -1 ) );
+    // Known discrepancy:  in 5+ an eigenvalue crosses E downwards near 3.98
+    // and back up just below the pole at 5.2999, and the same happens
+    // between the poles at 6.968 and 7.008.  The eigenvalue counts do not
+    // change across either region, so the search misses both pairs.
+    EXPECT_EQ( 4, compare_linearized( 5,  1 ) );
+}
+
+// Where the real part of a complex pair crosses E, as in 1- near 0.5, the
+// eigenvalue counts change but there is no root.
+TEST( Search, RealRoots ) {
+    std::vector< double > asymptotes;
+    MatrixFactory mf = build_test_channel( 1, -1, asymptotes );
+    std::vector< double > searched
+        = solve_derpa_eigenvalues( 10, mf, asymptotes );
+    ASSERT_FALSE( searched.empty() );
+    BOOST_FOREACH( double E, searched ) {
+        EXPECT_TRUE( is_real_root( mf, E, 1e-4 ) ) << "E = " << E; }
+    EXPECT_LT( 1.0, searched.front() );
+}
+
+// Leaving out the 2p2h energies that are not poles of the channel gives
+// fewer regions and the same roots.
+TEST( Search, ResidueAsymptotes ) {
+    std::vector< double > poles;
+    MatrixFactory mf = build_test_channel( 1, -1, poles );
+    TestProblem p( "tests/data/ipm_modelspace.dat" );
+    std::vector< double > asymptotes
+        = get_erpa_asymptotes( 0, -1, 1, p.ppms, p.hhms, p.spms );
+    EXPECT_FALSE( poles.empty() );
+    EXPECT_LE( poles.size(), asymptotes.size() );
+
+    std::vector< double > all   = solve_derpa_eigenvalues( 10, mf, asymptotes );
+    std::vector< double > fewer = solve_derpa_eigenvalues( 10, mf, poles );
+    ASSERT_EQ( all.size(), fewer.size() );
+    for ( unsigned int i = 0; i < all.size(); ++i ) {
+        EXPECT_NEAR( all[i], fewer[i], 1e-6 ); }
+}
+
+// With every pole below Emax the search still covers the rest of the window,
+// and agrees with the linearized problem there.
+TEST( Search, AsymptotesBelowEmax ) {
+    std::vector< double > asymptotes;
+    MatrixFactory mf = build_test_channel( 0, 1, asymptotes );
+    // The poles of 0+ stop a little above 7 and start again past 30, so
+    // leaving out the first one above Emax gives a list that really ends
+    // well below it.
+    double Emax = 30;
+    std::vector< double > poles = mf.asymptotes( Emax, 0.0001 );
+    ASSERT_LT( Emax + 1, poles.back() );
+    poles.pop_back();
+    ASSERT_FALSE( poles.empty() );
+
+    std::vector< double > searched
+        = solve_derpa_eigenvalues( Emax, mf, poles );
+    std::vector< double > linearized
+        = solve_linearized_eigenvalues( Emax, mf, poles );
+    ASSERT_EQ( searched.size(), linearized.size() );
+    for ( unsigned int i = 0; i < searched.size(); ++i ) {
+        EXPECT_NEAR( searched[i], linearized[i], 1e-6 ); }
+    EXPECT_LT( poles.back(), searched.back() );
+
+    // A channel without poles:  the positive RPA eigenvalues below Emax.
+    TestProblem p( "tests/data/ipm_modelspace.dat" );
+    const std::vector< ParticleHoleState > &ph_states = p.phms[1][0][1];
+    util::matrix_t rpa_matrix(
+            build_static_rpa_matrix( p.static_terms(), ph_states ) );
+    MatrixFactory rpa( rpa_matrix, std::vector< PoleTerm >(), ph_states,
+                       1, -1, 0 );
+
+    std::vector< double > expected;
+    BOOST_FOREACH( double v, util::sorted_eigenvalues( rpa_matrix ) ) {
+        if ( 0 < v && v < Emax )
+            expected.push_back( v ); }
+    std::vector< double > found
+        = solve_derpa_eigenvalues( Emax, rpa, std::vector< double >() );
+    EXPECT_FALSE( expected.empty() );
+    ASSERT_EQ( expected.size(), found.size() );
+    for ( unsigned int i = 0; i < found.size(); ++i ) {
+        EXPECT_NEAR( expected[i], found[i], 1e-6 ); }
+}
+
+// Where B* == B^T the ERPA probe counts the eigenvalues by inertia, without
+// computing (or caching) them.  Elsewhere it does not try.
+TEST( Search, InertiaProbe ) {
+    std::vector< double > asymptotes;
+    MatrixFactory mf = build_test_channel( 0, 1, asymptotes );
+    ASSERT_TRUE( mf.has_rpa_structure() );
+    boost::tuple< int, int > count = count_values( mf, 1.0 );
+    EXPECT_EQ( 0, mf.eigenvalue_cache().size() );
+    EXPECT_EQ( 0, mf.eigenvalue_cache().misses() );
+    EXPECT_EQ( split_values( mf.sorted_eigenvalues( 1.0 ), 1.0 ), count );
+
+    MatrixFactory other = build_test_channel( 1, -1, asymptotes );
+    EXPECT_FALSE( other.has_rpa_structure() );
+}
+
+// A second search over the same factory reuses the stored eigenvalues.
+TEST( Search, EigenvalueCache ) {
+    std::vector< double > asymptotes;
+    MatrixFactory mf = build_test_channel( 1, -1, asymptotes );
+
+    std::vector< double > first = solve_derpa_eigenvalues( 10, mf, asymptotes );
+    int hits = mf.eigenvalue_cache().hits();
+    std::vector< double > again = solve_derpa_eigenvalues( 10, mf, asymptotes );
+    EXPECT_EQ( first, again );
+    EXPECT_LT( hits, mf.eigenvalue_cache().hits() );
+    EXPECT_LT( 0, mf.eigenvalue_cache().size() );
+}
+
+// Searching the Chebyshev surrogates finds the exact roots.
+TEST( Search, Surrogate ) {
+    std::vector< double > asymptotes;
+    MatrixFactory mf = build_test_channel( 1, -1, asymptotes );
+
+    std::vector< double > exact = solve_derpa_eigenvalues( 10, mf, asymptotes );
+    std::vector< double > fitted
+        = solve_derpa_eigenvalues( 10, mf, asymptotes, 0.0001, 2, 24 );
+    ASSERT_EQ( exact.size(), fitted.size() );
+    for ( unsigned int i = 0; i < exact.size(); ++i ) {
+        EXPECT_NEAR( exact[i], fitted[i], 1e-6 ); }
+}
@@ -0,0 +1,38 @@
+#include <string>
+#include <vector>
+
+#include "modelspace_factories.h"
+#include "pp_interaction_factories.h"
+#include "ph_interaction_factories.h"
+#include "term_factories.h"
+#include "test_problem.h"
+
+TestProblem::TestProblem( const std::string &modelspace_file )
+    : spms( read_sp_modelspace_from_file( modelspace_file ) ),
+      phms( build_ph_modelspace_from_sp( spms ) ),
+      ppms( build_pp_modelspace_from_sp( spms ) ),
+      hhms( build_hh_modelspace_from_sp( spms ) ),
+      sems( build_se_modelspace_from_sp( spms ) ),
+      Gpp( build_gmatrix_from_mhj_file( "tests/data/test_interaction.mhj",
+                                        spms ) ),
+      sixj( new Wigner6jTable( spms.maxj ) ),
+      Gph( build_ph_interaction_from_pp( Gpp, spms, *sixj ) ),
+      phc( new StateChannels( build_ph_channels( phms, spms ) ) ),
+      ppc( new StateChannels( build_pp_channels( ppms, spms ) ) ),
+      hhc( new StateChannels( build_hh_channels( hhms, spms ) ) ) { }
+
+std::vector< Term > TestProblem::static_terms() const {
+    return build_rpa_terms( Gph, spms ); }
+
+std::vector< Term > TestProblem::dynamic_terms() const {
+    return build_dynamic_erpa_terms( Gph, Gpp, phc, ppc, hhc, sems, spms,
+                                     sixj ); }
+
+std::vector< PoleTerm > TestProblem::pole_terms() const {
+    return build_dynamic_erpa_pole_terms( Gph, Gpp, phc, ppc, hhc, sems,
+                                          spms, sixj ); }
+
+std::vector< PoleTerm >
+TestProblem::pole_terms( std::vector< Term > &B_terms ) const {
+    return build_dynamic_erpa_pole_terms( Gph, Gpp, phc, ppc, hhc, sems,
+                                          spms, sixj, B_terms ); }
@@ -0,0 +1,46 @@
+#ifndef _TEST_PROBLEM_H_
+#define _TEST_PROBLEM_H_
+/* The modelspaces, interactions and channels the ERPA tests share, for a
+ * single particle modelspace from tests/data and the test interaction.
+ *
+ *  TestProblem p( "tests/data/ipm_modelspace.dat" );
+ *  std::vector< Term > B_terms;
+ *  std::vector< PoleTerm > pole_terms = p.pole_terms( B_terms );
+ *  build_static_erpa_matrix( p.static_terms(), B_terms,
+ *                            p.phms[1][1][0] );
+ */
+
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+
+#include "Modelspace.h"
+#include "Interaction.h"
+#include "Term.h"
+#include "angular_momentum.h"
+
+struct TestProblem {
+    explicit TestProblem( const std::string &modelspace_file );
+
+    // build_rpa_terms
+    std::vector< Term >     static_terms() const;
+    // build_dynamic_erpa_terms
+    std::vector< Term >     dynamic_terms() const;
+    // build_dynamic_erpa_pole_terms, with and without the B blocks
+    std::vector< PoleTerm > pole_terms() const;
+    std::vector< PoleTerm > pole_terms( std::vector< Term > &B_terms ) const;
+
+    SingleParticleModelspace                 spms;
+    ParticleHoleModelspace                   phms;
+    ParticleParticleModelspace               ppms;
+    ParticleParticleModelspace               hhms;
+    SEModelspace                             sems;
+    PPInteraction                            Gpp;
+    boost::shared_ptr< const Wigner6jTable > sixj;
+    PHInteraction                            Gph;
+    boost::shared_ptr< const StateChannels > phc;
+    boost::shared_ptr< const StateChannels > ppc;
+    boost::shared_ptr< const StateChannels > hhc;
+};
+
+#endif // _TEST_PROBLEM_H_